@@ -4,6 +4,7 @@
 #include <snow.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <ui.h>
 
 static ui_app_t app;
@@ -61,12 +62,10 @@ void DG_SleepMs(uint32_t ms) {
 }
 
 uint32_t DG_GetTicksMs() {
-    sys_info_t si;
-    syscall2(SYS_INFO, SYS_INFO_UPTIME, (uintptr_t) &si);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    uint32_t t = si.uptime * 1000;
-
-    return t;
+    return ts.tv_sec*1000 + ts.tv_nsec/1000000;
 }
 
 int DG_GetKey(int* pressed, unsigned char* doomkey) {
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <kernel/uapi/uapi_clock.h>
+
+#include <stdint.h>
+
+void init_clock();
+uint64_t clock_get_ns();
+void clock_delay(uint32_t us);
+uintptr_t clock_ref_page();
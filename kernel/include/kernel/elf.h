@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+#define ELF_MAGIC 0x464C457F // "\x7FELF"
+#define ELF_CLASS_32 1
+#define ELF_DATA_LSB 1
+#define ELF_TYPE_EXEC 2
+#define ELF_MACHINE_386 3
+
+#define ELF_PT_LOAD 1
+
+#define ELF_PF_X 1
+#define ELF_PF_W 2
+#define ELF_PF_R 4
+
+typedef struct elf_header_t {
+    uint32_t magic;
+    uint8_t class;
+    uint8_t data;
+    uint8_t ident_version;
+    uint8_t abi;
+    uint8_t padding[8];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;
+    uint32_t phoff;
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} elf_header_t __attribute__((packed));
+
+typedef struct elf_phdr_t {
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+} elf_phdr_t __attribute__((packed));
@@ -5,4 +5,5 @@
 
 void init_fb(mb2_t* boot);
 
-fb_t fb_get_info();
\ No newline at end of file
+fb_t fb_get_info();
+void fb_flush(const wm_rect_t* rect);
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <stdint.h>
 
 void init_fpu();
+void fpu_init_cpu();
 void fpu_switch(process_t* prev, const process_t* next);
-void fpu_kernel_enter();
-void fpu_kernel_exit();
\ No newline at end of file
+void fpu_init_process(process_t* process);
+void fpu_fork(process_t* child);
+void fpu_exit(process_t* process);
\ No newline at end of file
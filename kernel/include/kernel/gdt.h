@@ -21,6 +21,9 @@
 #define GDT_ACCESS_USER_DATA (GDT_RW | GDT_S | GDT_DPL(3) | GDT_PRESENT)
 #define GDT_FLAGS (GDT_GRAN | GDT_32)
 
+// Each CPU has a TSS, whose entries follow the segments
+#define GDT_TSS_ENTRY 5
+
 // A GDT entry is structured as follows:
 // |base 24:31|flags 0:3|limit 16:19|access 0:7|base 16:23|base 0:15|limit 0:15|
 // where `access` is |P|DPL 0:1|S|Ex|DC|RW|Ac|
@@ -70,8 +73,9 @@ typedef struct {
 } __attribute__ ((packed)) tss_entry_t;
 
 void init_gdt();
+void gdt_init_cpu(uint32_t cpu);
 void gdt_set_entry(uint32_t num, uint32_t base, uint32_t limit, uint8_t access, uint8_t granularity);
-void gdt_write_tss(uint32_t num, uint32_t ss0, uint32_t esp0);
+void gdt_write_tss(uint32_t cpu, uint32_t ss0, uint32_t esp0);
 void gdt_set_kernel_stack(uintptr_t stack);
 
 extern void gdt_load(gdt_pointer_t* gdt_ptr);
\ No newline at end of file
@@ -5,6 +5,27 @@
 #define CLI() asm volatile("cli")
 #define STI() asm volatile("sti")
 
+#define EFLAGS_IF 0x200
+
+/* Disables interrupts for a section that interrupt handlers mustn't run in
+ * the middle of. Returns the previous %eflags, for `irq_restore`: such
+ * sections may be nested.
+ */
+static inline uint32_t irq_save() {
+    uint32_t eflags;
+    asm volatile("pushf\n"
+                 "pop %0\n"
+                 "cli" : "=r"(eflags) :: "memory");
+
+    return eflags;
+}
+
+static inline void irq_restore(uint32_t eflags) {
+    if (eflags & EFLAGS_IF) {
+        asm volatile("sti" ::: "memory");
+    }
+}
+
 void init_irq();
 void irq_handler(registers_t* regs);
 void irq_send_eoi(uint8_t irq);
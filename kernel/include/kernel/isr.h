@@ -46,4 +46,8 @@ extern void isr28();
 extern void isr29();
 extern void isr30();
 extern void isr31();
-extern void isr48();
\ No newline at end of file
+extern void isr48();
+extern void isr64();
+extern void isr65();
+extern void isr66();
+extern void isr255();
\ No newline at end of file
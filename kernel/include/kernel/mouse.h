@@ -27,7 +27,7 @@
 #define MOUSE_UNUSED_B (1 << 6)
 
 typedef struct {
-    float x, y;
+    int32_t x, y;
     bool left_pressed;
     bool right_pressed;
     bool middle_pressed;
@@ -39,6 +39,8 @@ void init_mouse(uint32_t dev);
 void mouse_handle_packet();
 void mouse_handle_interrupt(registers_t* regs);
 void mouse_set_callback(mouse_callback_t cb);
+bool mouse_states_equal(mouse_t* a, mouse_t* b);
+bool mouse_buttons_equal(mouse_t* a, mouse_t* b);
 
 void mouse_set_sample_rate(uint8_t rate);
 void mouse_set_resolution(uint8_t level);
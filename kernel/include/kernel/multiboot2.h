@@ -90,6 +90,7 @@ typedef struct mb2_tag_fb_t {
 
 /* TODO: reconsider moving those two once ACPI gets there */
 typedef struct acpi_rsdp1_t {
+    char signature[8]; // "RSD PTR "
     uint8_t checksum;
     char oem_id[6];
     uint8_t revision;
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <kernel/proc.h>
+#include <kernel/wait_queue.h>
+
+#include <stdbool.h>
+
+/* A lock whose waiters sleep, for long critical sections, see `mutex.c`.
+ */
+typedef struct {
+    process_t* owner; // NULL when unlocked
+    wait_queue_t waiters;
+} mutex_t;
+
+#define MUTEX_INIT(name) (mutex_t) { NULL, WAIT_QUEUE_INIT((name).waiters) }
+
+void mutex_lock(mutex_t* mutex);
+bool mutex_trylock(mutex_t* mutex);
+void mutex_unlock(mutex_t* mutex);
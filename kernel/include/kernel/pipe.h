@@ -2,4 +2,5 @@
 
 #include <kernel/fs.h>
 
-inode_t* pipe_new();
\ No newline at end of file
+inode_t* pipe_new();
+inode_t* pipe_open_end(inode_t* in, uint32_t flags);
\ No newline at end of file
@@ -13,9 +13,13 @@ uintptr_t pmm_alloc_page();
 uintptr_t pmm_alloc_aligned_large_page();
 uintptr_t pmm_alloc_pages(uint32_t num);
 void pmm_free_page(uintptr_t addr);
+void pmm_ref_page(uintptr_t addr);
+void pmm_unref_page(uintptr_t addr);
+uint32_t pmm_get_refcount(uintptr_t addr);
 void pmm_free_pages(uintptr_t addr, uint32_t num);
 uintptr_t pmm_get_kernel_end();
 
-extern uint32_t* mem_map;
+#define PMM_BLOCK_SIZE 4096
 
-#define PMM_BLOCK_SIZE 4096
\ No newline at end of file
+// Largest buddy block is 2^PMM_MAX_ORDER blocks, i.e. 4 MiB
+#define PMM_MAX_ORDER 10
\ No newline at end of file
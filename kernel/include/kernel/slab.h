@@ -0,0 +1,13 @@
+#pragma once
+
+#include <kernel/uapi/uapi_syscall.h>
+
+#include <stdint.h>
+
+typedef struct _kmem_cache_t kmem_cache_t;
+
+void init_slab();
+kmem_cache_t* kmem_cache_create(const char* name, uint32_t size);
+void* kmem_cache_alloc(kmem_cache_t* cache);
+void kmem_cache_free(kmem_cache_t* cache, void* obj);
+uint32_t kmem_cache_get_info(sys_cache_info_t* info, uint32_t max_caches);
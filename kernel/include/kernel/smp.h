@@ -0,0 +1,45 @@
+#pragma once
+
+#include <kernel/cpu.h>
+#include <kernel/proc.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SMP_TRAMPOLINE 0x8000 // Physical address at which APs start, see `smp.S`
+#define SMP_AP_STACK_SIZE 0x1000
+
+/* What each CPU needs to know about itself. The bootstrap processor is always
+ * `cpus[0]`.
+ * Processes stay on the CPU they're given when created, each CPU running its
+ * own scheduler. The idle process runs when that scheduler has nothing to
+ * run, see `proc_idle`.
+ */
+typedef struct {
+    uint32_t id; // Index in `cpus`
+    uint32_t apic_id;
+    volatile bool online;
+    process_t* current;
+    process_t* idle;
+    sched_t* scheduler;
+    uint32_t num_processes;
+    uint32_t lock_depth; // Of the big kernel lock, see `kernel_lock`
+    uint32_t tlb_gen; // See `smp_flush_tlbs`
+    bool need_resched; // Set when a system call should give up the CPU
+    volatile bool tlb_flush; // See `smp_flush_user_tlbs`
+} cpu_t;
+
+extern cpu_t cpus[MAX_CPUS];
+extern uint32_t num_cpus;
+
+void init_smp(const char* cmdline);
+cpu_t* cpu_get_current();
+void kernel_lock();
+void kernel_unlock();
+uint32_t kernel_drop_lock();
+void kernel_relock(uint32_t depth);
+void smp_flush_tlbs();
+void smp_sync_tlb();
+void smp_flush_user_tlbs();
+void smp_reschedule(cpu_t* cpu);
+void smp_kick(cpu_t* cpu);
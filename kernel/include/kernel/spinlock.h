@@ -0,0 +1,51 @@
+#pragma once
+
+#include <kernel/irq.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A lock that's busy-waited on, for short critical sections that may be
+ * entered from several CPUs at once. Holders mustn't sleep: use a mutex for
+ * that, see `mutex.c`.
+ * Data also used by interrupt handlers must be locked with interrupts
+ * disabled, with the `_irqsave` variants, lest a handler spins on a lock held
+ * by the code it interrupted.
+ */
+typedef struct {
+    volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT ((spinlock_t) { .locked = 0 })
+
+static inline void spin_lock(spinlock_t* lock) {
+    while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+        // Wait for the lock to look free before trying again, without
+        // bouncing its cache line between CPUs
+        while (lock->locked) {
+            asm volatile("pause");
+        }
+    }
+}
+
+/* Takes the lock if it's free, returns whether it was.
+ */
+static inline bool spin_trylock(spinlock_t* lock) {
+    return !lock->locked && !__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE);
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t eflags = irq_save();
+    spin_lock(lock);
+
+    return eflags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t eflags) {
+    spin_unlock(lock);
+    irq_restore(eflags);
+}
@@ -2,18 +2,26 @@
 
 #include <kernel/irq.h>
 
+#include <stdbool.h>
+
 void init_timer();
 void timer_callback();
 uint32_t timer_get_tick();
-float timer_get_time();
 void timer_register_callback(handler_t handler);
 void timer_remove_callback(handler_t handler);
+void timer_set_oneshot(uint32_t ticks);
+void timer_set_periodic();
+bool timer_ticks_by(uint32_t tick);
 
 #define TIMER_FREQ 50 // in Hz
 #define TIMER_QUOTIENT 1193180
+#define TIMER_DIVISOR (TIMER_QUOTIENT / TIMER_FREQ)
+#define PIT_MAX_ONESHOT_TICKS (0xFFFF / TIMER_DIVISOR) // The counter is 16 bits
 
 #define PIT_0 0x40
 #define PIT_1 0x41
 #define PIT_2 0x42
 #define PIT_CMD 0x43
-#define PIT_SET 0x36
\ No newline at end of file
+#define PIT_SET 0x36     // Channel 0, square wave
+#define PIT_ONESHOT 0x30 // Channel 0, interrupt on terminal count
+#define PIT_LATCH 0x00
\ No newline at end of file
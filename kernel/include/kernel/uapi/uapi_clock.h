@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+#define CLOCK_MONOTONIC 1
+
+/* The clock page is mapped read-only in every process, right below its stack,
+ * so that the time can be read without a system call.
+ */
+#define CLOCK_PAGE_ADDR 0xBFEFF000
+
+/* The time since the clock was calibrated, in nanoseconds, is
+ * `((tsc - tsc_base) * mult) >> shift`. `mult` is zero when the TSC can't be
+ * used, in which case `SYS_CLOCK_GETTIME` has to be called.
+ */
+typedef struct {
+    uint64_t tsc_base;
+    uint32_t mult;
+    uint32_t shift;
+} clock_page_t;
+
+struct timespec {
+    int32_t tv_sec;
+    int32_t tv_nsec;
+};
+
+static inline uint64_t clock_read_tsc() {
+    uint64_t tsc;
+    asm volatile("rdtsc" : "=A"(tsc));
+
+    return tsc;
+}
+
+/* Splits the multiplication so that it doesn't overflow 64 bits.
+ */
+static inline uint64_t clock_tsc_to_ns(const clock_page_t* page, uint64_t tsc) {
+    uint64_t delta = tsc - page->tsc_base;
+    uint64_t low = ((delta & 0xFFFFFFFF) * page->mult) >> page->shift;
+    uint64_t high = ((delta >> 32) * page->mult) << (32 - page->shift);
+
+    return high + low;
+}
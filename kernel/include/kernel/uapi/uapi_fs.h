@@ -13,6 +13,7 @@
 #define O_WRONLY 4
 #define O_TRUNC  8
 #define O_RDWR   16
+#define O_NONBLOCK 64
 
 #define SEEK_SET 1
 #define SEEK_CUR 2
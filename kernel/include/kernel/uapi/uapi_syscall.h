@@ -26,18 +26,56 @@
 #define SYS_RENAME 20
 #define SYS_MAKETTY 21
 #define SYS_STAT 22
-#define SYS_MAX 23 // First invalid syscall number
+#define SYS_FORK 23
+#define SYS_CLOCK_GETTIME 24
+#define SYS_THREAD_CREATE 25
+#define SYS_THREAD_EXIT 26
+#define SYS_THREAD_JOIN 27
+#define SYS_FUTEX_WAIT 28
+#define SYS_FUTEX_WAKE 29
+#define SYS_NOP 30
+#define SYS_MAX 31 // First invalid syscall number
+
+// How system calls enter the kernel, see `do_syscall.S` in libc
+#define SYSCALL_MODE_UNKNOWN 0
+#define SYSCALL_MODE_INT 1
+#define SYSCALL_MODE_SYSENTER 2
 
 #define SYS_INFO_UPTIME 1
 #define SYS_INFO_MEMORY 2
 #define SYS_INFO_LOG    4
+#define SYS_INFO_CACHES 8
+#define SYS_INFO_WM     16
+
+#define SYS_INFO_MAX_CACHES 16
+
+/* Usage of one of the kernel's object caches, see `slab.c`.
+ */
+typedef struct {
+    char name[16];
+    uint32_t obj_size;
+    uint32_t active_objs;
+    uint32_t total_objs;
+    uint32_t num_pages;
+} sys_cache_info_t;
+
+/* Work done by the window manager's compositor, see `wm.c`.
+ */
+typedef struct {
+    uint32_t frames;
+    uint64_t pixels; // Drawn to the back buffer
+    uint64_t time_ns; // Spent compositing
+} sys_wm_info_t;
 
 typedef struct {
     uint32_t kernel_heap_usage;
     uint32_t ram_usage;
     uint32_t ram_total;
-    float uptime;
+    uint32_t uptime_ms;
     char* kernel_log; // Must be at least 2048 bytes long
+    uint32_t num_caches;
+    sys_cache_info_t caches[SYS_INFO_MAX_CACHES];
+    sys_wm_info_t wm;
 } sys_info_t;
 
 typedef struct {
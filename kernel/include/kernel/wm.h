@@ -1,20 +1,23 @@
 #pragma once
 
 #include <kernel/fb.h>
+#include <kernel/wait_queue.h>
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <list.h>
 #include <ringbuffer.h>
 
+#include <kernel/uapi/uapi_syscall.h>
 #include <kernel/uapi/uapi_wm.h>
 
 #define WM_NOT_DRAWN  ((uint32_t) 1 << 31) // Window has _never_ been called wm_render_window
 
 /* ufb: the window's buffer in userspace. Used by the client for drawing
- *  operations. We copy this buffer on request to `kfb`.
- * kfb: the drawn window's buffer held by the WM. This is used to redraw the
+ *  operations.
+ * kfb: the same buffer, as mapped in the kernel. This is used to redraw the
  *  window when we're not in the window's address space.
+ * Both map the same pages, allocated by the WM, see `wm_open_window`.
  */
 typedef struct _wm_window_t {
     fb_t ufb;
@@ -23,20 +26,24 @@ typedef struct _wm_window_t {
     uint32_t id;
     uint32_t flags;
     ringbuffer_t* events;
+    wait_queue_t waiters; // Processes waiting for events
+    uint32_t owner; // Pid of the process that has `ufb` mapped
+    uint32_t num_waiters; // Sleeping in `wm_wait_event`, see `wm_close_window`
+    bool closed;
 } wm_window_t;
 
 // Rename this for convenience.
 typedef wm_rect_t rect_t;
 
-void init_wm();
+void init_wm(const char* cmdline);
 
 uint32_t wm_open_window(fb_t* fb, uint32_t flags);
 void wm_close_window(uint32_t win_id);
 void wm_render_window(uint32_t win_id, rect_t* clip);
 void wm_get_event(uint32_t win_id, wm_event_t* event);
-
-bool wm_is_titlebar_being_hovered(wm_window_t* win);
-list_t* wm_get_window(uint32_t id);
+void wm_wait_event(uint32_t win_id, wm_event_t* event, uint32_t timeout);
+void wm_get_info(sys_wm_info_t* info);
+bool wm_is_hovered(uint32_t win_id);
 
 // rect-handling functions
 rect_t* rect_new_copy(rect_t r);
@@ -46,4 +53,6 @@ void rect_subtract_clip_rect(list_t* rects, rect_t clip);
 void rect_add_clip_rect(list_t* rects, rect_t clip);
 void print_rect(rect_t* r);
 bool rect_intersect(rect_t a, rect_t b);
+rect_t rect_bounding_box(rect_t a, rect_t b);
+uint32_t rect_area(rect_t r);
 void rect_clear_clipped(list_t* rects);
\ No newline at end of file
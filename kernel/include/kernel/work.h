@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Work deferred by an interrupt handler, see `work.c`.
+ */
+typedef struct _work_t {
+    void (*func)();
+    volatile bool pending; // Scheduled, but not started yet
+    struct _work_t* next;
+} work_t;
+
+#define WORK_INIT(f) (work_t) { .func = (f), .pending = false, .next = NULL }
+
+/* A ring of fixed-size elements with a single producer, an interrupt handler,
+ * and a single consumer, the work it schedules. Each index is only written by
+ * one side, so neither needs a lock.
+ * `buf` must be an array whose length is a power of two.
+ */
+typedef struct {
+    volatile uint32_t head; // Total elements pushed, producer only
+    volatile uint32_t tail; // Total elements popped, consumer only
+    uint32_t size;
+    uint32_t elem_size;
+    uint8_t* data;
+} work_ring_t;
+
+#define WORK_RING_INIT(buf) (work_ring_t) { \
+        .head = 0, \
+        .tail = 0, \
+        .size = sizeof(buf)/sizeof((buf)[0]), \
+        .elem_size = sizeof((buf)[0]), \
+        .data = (uint8_t*) (buf) \
+    }
+
+void init_work();
+void work_schedule(work_t* work);
+
+bool work_ring_push(work_ring_t* ring, const void* elem);
+bool work_ring_peek(work_ring_t* ring, void* elem);
+bool work_ring_pop(work_ring_t* ring, void* elem);
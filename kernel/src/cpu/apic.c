@@ -0,0 +1,202 @@
+#include <kernel/acpi.h>
+#include <kernel/apic.h>
+#include <kernel/clock.h>
+#include <kernel/cpu.h>
+#include <kernel/irq.h>
+#include <kernel/paging.h>
+#include <kernel/timer.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+
+#define APIC_CALIBRATION_HZ 100 // Calibrate the timer over 10 ms
+
+static volatile uint32_t* lapic;
+static volatile uint32_t* ioapic;
+static bool enabled = false;
+static uint32_t timer_counts; // Local APIC timer counts per tick
+
+void apic_spurious_handler(registers_t* regs);
+
+static uint32_t lapic_read(uint32_t reg);
+static void lapic_write(uint32_t reg, uint32_t value);
+static uint32_t ioapic_read(uint32_t reg);
+static void ioapic_write(uint32_t reg, uint32_t value);
+static uint32_t ioapic_pin(uint32_t irq);
+static void apic_calibrate_timer();
+
+/* Replaces the PICs with the local APIC and the IOAPIC described by the MADT,
+ * which other processors can't do without. ISA IRQs are sent to the
+ * bootstrap processor with the vectors the PICs used, so that they're handled
+ * as before, see `irq.c`. They start out masked.
+ */
+void init_apic() {
+    const acpi_info_t* info = acpi_get_info();
+
+    if (!info) {
+        return;
+    }
+
+    if (!(cpu_features() & CPUID_APIC)) {
+        printke("the MADT lists APICs, but the CPU doesn't have one");
+        return;
+    }
+
+    lapic = paging_map_mmio(info->lapic_addr, 0x1000);
+    ioapic = paging_map_mmio(info->ioapic_addr, 0x20);
+
+    irq_set_mask(PIC1_DATA, 0xFF);
+    irq_set_mask(PIC2_DATA, 0xFF);
+
+    isr_register_handler(APIC_SPURIOUS_VECTOR, apic_spurious_handler);
+    apic_init_cpu();
+
+    uint32_t bsp = apic_get_id();
+    uint32_t max_pin = (ioapic_read(IOAPIC_VERSION) >> 16) & 0xFF;
+
+    for (uint32_t irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        uint32_t pin = info->irq_gsi[irq] - info->ioapic_gsi_base;
+        uint16_t flags = info->irq_flags[irq];
+        uint32_t entry = (IRQ0 + irq) | IOAPIC_MASKED;
+
+        if (pin > max_pin) {
+            continue;
+        }
+
+        if ((flags & MADT_POLARITY_LOW) == MADT_POLARITY_LOW) {
+            entry |= IOAPIC_ACTIVE_LOW;
+        }
+
+        if ((flags & MADT_TRIGGER_LEVEL) == MADT_TRIGGER_LEVEL) {
+            entry |= IOAPIC_LEVEL;
+        }
+
+        ioapic_write(IOAPIC_REDIRECTION + 2*pin + 1, bsp << 24);
+        ioapic_write(IOAPIC_REDIRECTION + 2*pin, entry);
+    }
+
+    apic_calibrate_timer();
+    enabled = true;
+
+    printk("using the APIC");
+}
+
+/* Enables the local APIC of the current CPU.
+ */
+void apic_init_cpu() {
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, APIC_SPURIOUS_VECTOR | LAPIC_ENABLE);
+}
+
+/* Returns whether interrupts go through the APIC rather than the PICs.
+ */
+bool apic_enabled() {
+    return enabled;
+}
+
+uint32_t apic_get_id() {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+void apic_send_eoi() {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/* Sends an inter-processor interrupt to the CPU with the given APIC ID.
+ * `command` holds the delivery mode and vector, e.g. `ICR_FIXED | vector`.
+ */
+void apic_send_ipi(uint32_t apic_id, uint32_t command) {
+    while (lapic_read(LAPIC_ICR_LOW) & ICR_PENDING) {
+        asm volatile("pause");
+    }
+
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+}
+
+/* Has the local APIC of the current CPU interrupt it `TIMER_FREQ` times a
+ * second, with vector `APIC_TIMER_VECTOR`.
+ */
+void apic_start_timer() {
+    apic_set_timer(true, timer_counts);
+}
+
+/* Has the local APIC timer of the current CPU interrupt it after `counts` of
+ * its cycles, once or every time. See `timer.c`.
+ */
+void apic_set_timer(bool periodic, uint32_t counts) {
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, APIC_TIMER_VECTOR | (periodic ? LAPIC_TIMER_PERIODIC : 0));
+    lapic_write(LAPIC_TIMER_INITIAL, counts);
+}
+
+/* Returns how many cycles the current CPU's timer has left to count before it
+ * interrupts. A one-shot timer stays at zero once it's done.
+ */
+uint32_t apic_get_timer_left() {
+    return lapic_read(LAPIC_TIMER_CURRENT);
+}
+
+/* Returns how many cycles the timer counts per tick.
+ */
+uint32_t apic_get_timer_counts() {
+    return timer_counts;
+}
+
+/* Masks or unmasks `irq`, in the `IRQ0-IRQ15` range, in the IOAPIC.
+ */
+void apic_mask_irq(uint32_t irq, bool mask) {
+    uint32_t reg = IOAPIC_REDIRECTION + 2*ioapic_pin(irq - IRQ0);
+    uint32_t entry = ioapic_read(reg);
+
+    ioapic_write(reg, mask ? entry | IOAPIC_MASKED : entry & ~IOAPIC_MASKED);
+}
+
+/* Nothing to do, not even an EOI.
+ */
+void apic_spurious_handler(registers_t* regs) {
+    UNUSED(regs);
+}
+
+static uint32_t lapic_read(uint32_t reg) {
+    return lapic[reg / 4];
+}
+
+static void lapic_write(uint32_t reg, uint32_t value) {
+    lapic[reg / 4] = value;
+}
+
+static uint32_t ioapic_read(uint32_t reg) {
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+
+    return ioapic[IOAPIC_WINDOW / 4];
+}
+
+static void ioapic_write(uint32_t reg, uint32_t value) {
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+    ioapic[IOAPIC_WINDOW / 4] = value;
+}
+
+/* Returns the IOAPIC pin ISA IRQ `irq` is wired to.
+ */
+static uint32_t ioapic_pin(uint32_t irq) {
+    const acpi_info_t* info = acpi_get_info();
+
+    return info->irq_gsi[irq] - info->ioapic_gsi_base;
+}
+
+/* Counts down the local APIC timer for a known duration, to know how to
+ * program it. Every CPU's timer is assumed to run at the same frequency.
+ */
+static void apic_calibrate_timer() {
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_MASKED);
+    lapic_write(LAPIC_TIMER_INITIAL, 0xFFFFFFFF);
+
+    clock_delay(1000000 / APIC_CALIBRATION_HZ);
+
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+    lapic_write(LAPIC_TIMER_INITIAL, 0);
+
+    timer_counts = elapsed * APIC_CALIBRATION_HZ / TIMER_FREQ;
+}
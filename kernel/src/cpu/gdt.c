@@ -1,15 +1,22 @@
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
+#include <kernel/cpu.h>
 #include <kernel/gdt.h>
 #include <kernel/idt.h>
 
-static gdt_entry_t gdt_entries[6];
+extern void sysenter_entry();
+
+static gdt_entry_t gdt_entries[GDT_TSS_ENTRY + MAX_CPUS];
 static gdt_pointer_t gdt_ptr;
 
-static tss_entry_t tss;
+// One per CPU, each holding the kernel stack of the process running there
+static tss_entry_t tss[MAX_CPUS];
+static bool sysenter = false;
 
-/* Loads up and fills the GDT with all the entries we need.
+/* Fills the GDT with all the entries we need, and loads it on the bootstrap
+ * processor.
  */
 void init_gdt() {
     gdt_ptr.offset = (uint32_t) &gdt_entries;
@@ -21,13 +28,31 @@ void init_gdt() {
     gdt_set_entry(3, 0, 0xFFFFFFFF, GDT_ACCESS_USER_CODE, GDT_FLAGS);
     gdt_set_entry(4, 0, 0xFFFFFFFF, GDT_ACCESS_USER_DATA, GDT_FLAGS);
 
-    gdt_write_tss(5, 0x10, 0x00);
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        gdt_write_tss(cpu, 0x10, 0x00);
+    }
+
+    sysenter = cpu_features() & CPUID_SEP;
+
+    gdt_init_cpu(0);
+}
 
+/* Loads the GDT and the TSS of `cpu` on the CPU we're running on, see
+ * `ap_main` for the other CPUs.
+ */
+void gdt_init_cpu(uint32_t cpu) {
     gdt_load(&gdt_ptr);
 
-    // 0x2B = 0+5*8bytes | 3 (bottom 2 bits control ring number)
-    asm("mov $0x2B, %ax\n" // Flush the TSS
-        "ltr %ax\n");
+    // e.g. 0x2B = 0+5*8bytes | 3 (bottom 2 bits control ring number)
+    uint16_t selector = ((GDT_TSS_ENTRY + cpu) * 8) | 3;
+    asm volatile("ltr %0" :: "r"(selector)); // Flush the TSS
+
+    // System calls can also be made with `sysenter`, which is much faster than
+    // `int $0x30`. It expects user segments to follow the kernel's, in order.
+    if (sysenter) {
+        cpu_write_msr(MSR_SYSENTER_CS, 0x08);
+        cpu_write_msr(MSR_SYSENTER_EIP, (uintptr_t) sysenter_entry);
+    }
 }
 
 /* See `gdt.h` for some "explanation" of the parameters here.
@@ -46,26 +71,31 @@ void gdt_set_entry(uint32_t num, uint32_t base, uint32_t limit, uint8_t access,
     gdt_entries[num].access = access;
 }
 
-/* Writes the GDT entry corresponding to a barebones TSS with a specific
- * data segment selector `ss0` and stack pointer `esp0`.
+/* Writes the GDT entry corresponding to the barebones TSS of `cpu` with a
+ * specific data segment selector `ss0` and stack pointer `esp0`.
  * Shamelessly taken from ToaruOS :)
  */
-void gdt_write_tss(uint32_t num, uint32_t ss0, uint32_t esp0) {
-    uintptr_t base = (uintptr_t) &tss;
-    uintptr_t limit = base + sizeof(tss);
+void gdt_write_tss(uint32_t cpu, uint32_t ss0, uint32_t esp0) {
+    uintptr_t base = (uintptr_t) &tss[cpu];
+    uintptr_t limit = base + sizeof(tss_entry_t);
 
     /* Add the TSS descriptor to the GDT */
-    gdt_set_entry(num, base, limit, 0xE9, 0x00);
+    gdt_set_entry(GDT_TSS_ENTRY + cpu, base, limit, 0xE9, 0x00);
 
-    memset(&tss, 0x00, sizeof(tss));
+    memset(&tss[cpu], 0x00, sizeof(tss_entry_t));
 
-    tss.ss0 = ss0;
-    tss.esp0 = esp0;
-    tss.iomap_base = sizeof(tss);
+    tss[cpu].ss0 = ss0;
+    tss[cpu].esp0 = esp0;
+    tss[cpu].iomap_base = sizeof(tss_entry_t);
 }
 
-/* Sets the stack pointer that will be used when the next interrupt happens.
+/* Sets the stack pointer that will be used when the next interrupt, or
+ * `sysenter`, happens on the current CPU.
  */
 void gdt_set_kernel_stack(uintptr_t stack) {
-    tss.esp0 = stack;
+    tss[cpu_get_id()].esp0 = stack;
+
+    if (sysenter) {
+        cpu_write_msr(MSR_SYSENTER_ESP, stack);
+    }
 }
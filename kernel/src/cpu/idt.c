@@ -12,6 +12,12 @@ void init_idt() {
     idt_ptr.size = sizeof(idt_entry_t)*256 - 1;
     idt_ptr.offset = (uint32_t) &idt_entries;
 
+    idt_load();
+}
+
+/* Loads the IDT on the current CPU. Every CPU shares the same one.
+ */
+void idt_load() {
     asm ("lidt (%0)\n" :: "r" (&idt_ptr));
 }
 
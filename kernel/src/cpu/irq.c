@@ -1,5 +1,5 @@
+#include <kernel/apic.h>
 #include <kernel/com.h>
-#include <kernel/fpu.h>
 #include <kernel/idt.h>
 #include <kernel/irq.h>
 #include <kernel/sys.h>
@@ -54,10 +54,8 @@ void init_irq() {
 void irq_handler(registers_t* regs) {
     uint32_t irq = regs->int_no;
 
-    fpu_kernel_enter();
-
-    // Handle spurious interrupts
-    if (irq == IRQ7 || irq == IRQ15) {
+    // Handle spurious interrupts, which the IOAPIC doesn't send
+    if (!apic_enabled() && (irq == IRQ7 || irq == IRQ15)) {
         uint16_t isr = irq_get_isr();
 
         // If it's a real interrupt, the corresponding bit will be set in the ISR
@@ -81,11 +79,14 @@ void irq_handler(registers_t* regs) {
     } else {
         printke("unhandled IRQ%d", irq - IRQ0);
     }
-
-    fpu_kernel_exit();
 }
 
 void irq_send_eoi(uint8_t irq) {
+    if (apic_enabled()) {
+        apic_send_eoi();
+        return;
+    }
+
     // Send EOI to PIC2 if necessary
     if (irq > IRQ7) {
         outportb(PIC2_CMD, PIC_EOI);
@@ -95,7 +96,8 @@ void irq_send_eoi(uint8_t irq) {
     outportb(PIC1_CMD, PIC_EOI);
 }
 
-/* Registers a function that'll be called when `irq` is raised by a PIC.
+/* Registers a function that'll be called when `irq` is raised by a PIC, or
+ * the IOAPIC.
  * There can only be one per IRQ; subsequent calls will do nothing.
  */
 void irq_register_handler(uint8_t irq, handler_t handler) {
@@ -151,6 +153,11 @@ void irq_set_mask(uint16_t pic, uint8_t mask) {
 void irq_mask(uint32_t irq) {
     uint16_t pic = 0;
 
+    if (apic_enabled()) {
+        apic_mask_irq(irq, true);
+        return;
+    }
+
     if (irq < IRQ8) {
         pic = PIC1_DATA;
     } else {
@@ -169,6 +176,11 @@ void irq_mask(uint32_t irq) {
 void irq_unmask(uint32_t irq) {
     uint16_t pic = 0;
 
+    if (apic_enabled()) {
+        apic_mask_irq(irq, false);
+        return;
+    }
+
     if (irq < IRQ8) {
         pic = PIC1_DATA;
     } else {
@@ -1,4 +1,4 @@
-#include <kernel/fpu.h>
+#include <kernel/apic.h>
 #include <kernel/idt.h>
 #include <kernel/isr.h>
 #include <kernel/sys.h>
@@ -87,6 +87,12 @@ void init_isr() {
 
     // Syscall interrupt gate
     idt_set_entry(48, (uint32_t) isr48, 0x08, IDT_INT_USER);
+
+    // Local APIC interrupts, see `apic.c`
+    idt_set_entry(APIC_TIMER_VECTOR, (uint32_t) isr64, 0x08, IDT_INT_KERNEL);
+    idt_set_entry(APIC_RESCHEDULE_VECTOR, (uint32_t) isr65, 0x08, IDT_INT_KERNEL);
+    idt_set_entry(APIC_TLB_VECTOR, (uint32_t) isr66, 0x08, IDT_INT_KERNEL);
+    idt_set_entry(APIC_SPURIOUS_VECTOR, (uint32_t) isr255, 0x08, IDT_INT_KERNEL);
 }
 
 /* Calls the handler registered to a specific interrupt, if any.
@@ -96,8 +102,6 @@ void init_isr() {
 void isr_handler(registers_t* regs) {
     assert(regs->int_no < 256);
 
-    fpu_kernel_enter();
-
     if (isr_handlers[regs->int_no]) {
         handler_t handler = isr_handlers[regs->int_no];
         handler(regs);
@@ -108,8 +112,6 @@ void isr_handler(registers_t* regs) {
         // TODO: we're better than this
         abort();
     }
-
-    fpu_kernel_exit();
 }
 
 /* Registers a handler to be called when interrupt `num` fires.
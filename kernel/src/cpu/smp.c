@@ -0,0 +1,305 @@
+#include <kernel/acpi.h>
+#include <kernel/apic.h>
+#include <kernel/clock.h>
+#include <kernel/fpu.h>
+#include <kernel/gdt.h>
+#include <kernel/idt.h>
+#include <kernel/paging.h>
+#include <kernel/smp.h>
+#include <kernel/spinlock.h>
+#include <kernel/sys.h>
+#include <kernel/timer.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SMP_START_TIMEOUT_MS 100
+
+// Where the trampoline's variables end up once it's copied, see `smp.S`
+#define TRAMPOLINE_VAR(var) \
+    (*(uint32_t*) (SMP_TRAMPOLINE + ((uintptr_t) &var - (uintptr_t) smp_trampoline)))
+
+extern uint8_t smp_trampoline[];
+extern uint8_t smp_trampoline_end[];
+extern uint32_t smp_trampoline_cr3;
+extern uint32_t smp_trampoline_stack;
+
+cpu_t cpus[MAX_CPUS];
+uint32_t num_cpus = 1;
+
+/* The big kernel lock: only one CPU runs kernel code at a time, so that the
+ * kernel can keep assuming that nothing changes under its feet while
+ * interrupts are disabled. Processes still run in parallel in userspace.
+ * It's taken on every way into the kernel and released on the way out, see
+ * `isr.S`, `irq.S` and `sysenter.S`, and is held across context switches.
+ * The physical memory manager, the kernel heap and the window manager have
+ * locks of their own, so that work on them alone may run without it, see
+ * `kernel_drop_lock`.
+ */
+static spinlock_t kernel_spinlock = SPINLOCK_INIT;
+static volatile uint32_t tlb_gen = 0;
+
+// The AP being started, as it can't know its index in `cpus` by itself
+static volatile uint32_t starting_cpu;
+
+void ap_main();
+void smp_timer_handler(registers_t* regs);
+void smp_reschedule_handler(registers_t* regs);
+void smp_tlb_handler();
+
+static bool smp_start_ap(cpu_t* cpu);
+static void smp_answer_tlb_flush(cpu_t* cpu);
+
+/* Starts the application processors listed in the MADT, unless "nosmp" is
+ * passed on the kernel command line.
+ * The bootstrap processor holds the big kernel lock from then on, until it
+ * runs its first process: APs wait for it before running any, see `ap_main`.
+ */
+void init_smp(const char* cmdline) {
+    kernel_lock();
+
+    cpus[0].online = true;
+
+    const acpi_info_t* info = acpi_get_info();
+
+    if (!apic_enabled()) {
+        return;
+    }
+
+    cpus[0].apic_id = apic_get_id();
+
+    isr_register_handler(APIC_TIMER_VECTOR, smp_timer_handler);
+    isr_register_handler(APIC_RESCHEDULE_VECTOR, smp_reschedule_handler);
+
+    if (cmdline && strstr(cmdline, "nosmp")) {
+        return;
+    }
+
+    // The trampoline is identity mapped in the kernel's page directory
+    memcpy((void*) SMP_TRAMPOLINE, smp_trampoline, smp_trampoline_end - smp_trampoline);
+    TRAMPOLINE_VAR(smp_trampoline_cr3) = paging_get_kernel_directory();
+
+    for (uint32_t i = 0; i < info->num_cpus; i++) {
+        if (info->apic_ids[i] == cpus[0].apic_id) {
+            continue;
+        }
+
+        cpu_t* cpu = &cpus[num_cpus];
+        cpu->id = num_cpus;
+        cpu->apic_id = info->apic_ids[i];
+
+        // A CPU that comes up late would take the next one's place
+        if (!smp_start_ap(cpu)) {
+            printke("CPU with APIC ID %d didn't start", cpu->apic_id);
+            break;
+        }
+
+        num_cpus++;
+    }
+
+    printk("%d CPU(s) online", num_cpus);
+}
+
+cpu_t* cpu_get_current() {
+    return &cpus[cpu_get_id()];
+}
+
+/* Takes the big kernel lock, or just counts one more reference to it if this
+ * CPU holds it already.
+ */
+void kernel_lock() {
+    cpu_t* cpu = cpu_get_current();
+
+    if (cpu->lock_depth++) {
+        return;
+    }
+
+    while (!spin_trylock(&kernel_spinlock)) {
+        // Its holder may be waiting for us to flush our TLB
+        smp_answer_tlb_flush(cpu);
+        asm volatile("pause");
+    }
+
+    smp_sync_tlb();
+}
+
+void kernel_unlock() {
+    cpu_t* cpu = cpu_get_current();
+
+    if (--cpu->lock_depth) {
+        return;
+    }
+
+    spin_unlock(&kernel_spinlock);
+}
+
+/* Releases the big kernel lock however many times this CPU holds it, for long
+ * work on data that has a lock of its own, e.g. compositing, see `wm.c`.
+ * That work mustn't sleep nor touch anything else, and must call
+ * `smp_sync_tlb` once it holds its lock. Returns what to pass to
+ * `kernel_relock` after it.
+ * The other lock must be taken with interrupts disabled: an interrupt handler
+ * would otherwise wait for the big kernel lock, whose holder may be waiting
+ * for the other lock.
+ */
+uint32_t kernel_drop_lock() {
+    cpu_t* cpu = cpu_get_current();
+    uint32_t depth = cpu->lock_depth;
+
+    cpu->lock_depth = 0;
+    spin_unlock(&kernel_spinlock);
+
+    return depth;
+}
+
+void kernel_relock(uint32_t depth) {
+    kernel_lock();
+    cpu_get_current()->lock_depth = depth;
+}
+
+/* Has every other CPU flush its TLB before it next runs kernel code, after a
+ * kernel mapping was removed. They can't use that mapping in the meantime,
+ * as they don't hold the big kernel lock, and userspace can't either.
+ * Code that runs without the big kernel lock instead syncs when taking the
+ * lock of the data it uses, under which that data's mappings are removed.
+ */
+void smp_flush_tlbs() {
+    cpu_get_current()->tlb_gen = __atomic_add_fetch(&tlb_gen, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Flushes this CPU's TLB if a kernel mapping was removed since it last did,
+ * see `smp_flush_tlbs`.
+ */
+void smp_sync_tlb() {
+    cpu_t* cpu = cpu_get_current();
+
+    if (cpu->tlb_gen != tlb_gen) {
+        cpu->tlb_gen = tlb_gen;
+        paging_invalidate_cache();
+    }
+}
+
+/* Has the other CPUs that run threads of the current process flush their
+ * TLB, after one of its mappings was changed or removed, and waits for them
+ * to. They answer without the big kernel lock, which we hold: from the
+ * interrupt handler, or while waiting for the lock, see `kernel_lock`.
+ * The pages a mapping used mustn't be freed before this returns.
+ */
+void smp_flush_user_tlbs() {
+    cpu_t* self = cpu_get_current();
+
+    if (!self->current) {
+        return;
+    }
+
+    uintptr_t directory = self->current->directory;
+
+    for (uint32_t i = 0; i < num_cpus; i++) {
+        cpu_t* cpu = &cpus[i];
+
+        if (cpu != self && cpu->current && cpu->current->directory == directory) {
+            cpu->tlb_flush = true;
+            apic_send_ipi(cpu->apic_id, ICR_FIXED | ICR_ASSERT | APIC_TLB_VECTOR);
+        }
+    }
+
+    for (uint32_t i = 0; i < num_cpus; i++) {
+        while (cpus[i].tlb_flush) {
+            asm volatile("pause");
+        }
+    }
+}
+
+/* Makes `cpu` run its scheduler now rather than on its next tick, if it's
+ * idle. Called when a process it runs becomes runnable.
+ */
+void smp_reschedule(cpu_t* cpu) {
+    if (cpu != cpu_get_current() && cpu->current == cpu->idle) {
+        apic_send_ipi(cpu->apic_id, ICR_FIXED | ICR_ASSERT | APIC_RESCHEDULE_VECTOR);
+    }
+}
+
+/* Interrupts `cpu` whatever it's running, for it to go through `proc_preempt`.
+ */
+void smp_kick(cpu_t* cpu) {
+    apic_send_ipi(cpu->apic_id, ICR_FIXED | ICR_ASSERT | APIC_RESCHEDULE_VECTOR);
+}
+
+/* Where APs end up after the trampoline, in protected mode with paging
+ * enabled. They set themselves up like the bootstrap processor did in
+ * `kernel_main`, then run processes.
+ */
+void ap_main() {
+    cpu_t* cpu = &cpus[starting_cpu];
+
+    gdt_init_cpu(cpu->id);
+    idt_load();
+    fpu_init_cpu();
+    paging_init_cpu();
+    apic_init_cpu();
+
+    cpu->online = true;
+
+    kernel_lock();
+    apic_start_timer();
+    proc_enter_usermode();
+}
+
+/* Every CPU gets ticks from its local APIC. The bootstrap processor's keep
+ * time, see `timer.c`, other CPUs only run their scheduler then.
+ */
+void smp_timer_handler(registers_t* regs) {
+    apic_send_eoi();
+
+    if (cpu_get_current()->id == 0) {
+        timer_callback(regs);
+    } else {
+        proc_timer_callback(regs);
+    }
+}
+
+void smp_reschedule_handler(registers_t* regs) {
+    apic_send_eoi();
+    proc_preempt(regs);
+}
+
+/* Called from `isr.S` without the big kernel lock.
+ */
+void smp_tlb_handler() {
+    smp_answer_tlb_flush(cpu_get_current());
+    apic_send_eoi();
+}
+
+/* Wakes an AP up with the INIT-SIPI-SIPI sequence, the second SIPI being
+ * there in case the first one is missed. Returns whether it made it to
+ * `ap_main`.
+ */
+static bool smp_start_ap(cpu_t* cpu) {
+    uintptr_t stack = (uintptr_t) aligned_alloc(16, SMP_AP_STACK_SIZE);
+
+    TRAMPOLINE_VAR(smp_trampoline_stack) = stack + SMP_AP_STACK_SIZE;
+    starting_cpu = cpu->id;
+
+    apic_send_ipi(cpu->apic_id, ICR_INIT | ICR_ASSERT);
+    clock_delay(10000);
+
+    for (uint32_t i = 0; i < 2 && !cpu->online; i++) {
+        apic_send_ipi(cpu->apic_id, ICR_STARTUP | ICR_ASSERT | (SMP_TRAMPOLINE >> 12));
+        clock_delay(200);
+    }
+
+    for (uint32_t ms = 0; ms < SMP_START_TIMEOUT_MS && !cpu->online; ms++) {
+        clock_delay(1000);
+    }
+
+    return cpu->online;
+}
+
+/* Flushes the TLB if `smp_flush_user_tlbs` asked for it.
+ */
+static void smp_answer_tlb_flush(cpu_t* cpu) {
+    if (cpu->tlb_flush) {
+        paging_invalidate_cache();
+        cpu->tlb_flush = false;
+    }
+}
@@ -0,0 +1,178 @@
+#include <kernel/acpi.h>
+#include <kernel/paging.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ACPI_BIOS_BEGIN 0xE0000
+#define ACPI_BIOS_END 0x100000
+
+static acpi_info_t info;
+static bool found = false;
+
+static acpi_rsdp1_t* acpi_find_rsdp(mb2_t* boot, uint64_t* xsdt);
+static acpi_header_t* acpi_map_table(uintptr_t phys);
+static bool acpi_checksum(const void* data, uint32_t size);
+static void acpi_parse_madt(acpi_madt_t* madt);
+
+/* Finds the MADT through the RSDP given by GRUB, or found in the BIOS area
+ * otherwise, to know about processors and interrupt controllers.
+ * Without it, we stick to the PICs and a single processor.
+ */
+void init_acpi(mb2_t* boot) {
+    uint64_t xsdt = 0;
+    acpi_rsdp1_t* rsdp = acpi_find_rsdp(boot, &xsdt);
+
+    if (!rsdp) {
+        printke("no ACPI tables found");
+        return;
+    }
+
+    // Tables above 4 GiB are out of reach without PAE
+    bool extended = xsdt && xsdt < 0x100000000;
+    acpi_header_t* root = acpi_map_table(extended ? (uintptr_t) xsdt : rsdp->rsdt_addr);
+
+    if (!root) {
+        printke("invalid ACPI root table");
+        return;
+    }
+
+    uint32_t entry_size = extended ? sizeof(uint64_t) : sizeof(uint32_t);
+    uint32_t num_entries = (root->length - sizeof(acpi_header_t)) / entry_size;
+    uint8_t* entries = (uint8_t*) root + sizeof(acpi_header_t);
+
+    for (uint32_t i = 0; i < num_entries; i++) {
+        uint64_t addr = 0;
+        memcpy(&addr, entries + i*entry_size, entry_size);
+
+        if (addr >= 0x100000000) {
+            continue;
+        }
+
+        acpi_header_t* table = acpi_map_table((uintptr_t) addr);
+
+        if (table && !strncmp(table->signature, "APIC", 4)) {
+            acpi_parse_madt((acpi_madt_t*) table);
+            return;
+        }
+    }
+
+    printke("no MADT found");
+}
+
+/* Returns what we learned from the MADT, or NULL if there was none.
+ */
+const acpi_info_t* acpi_get_info() {
+    return found ? &info : NULL;
+}
+
+/* Returns the RSDP, and the address of the XSDT in `xsdt` if there's one.
+ * The BIOS area is identity mapped, see `init_paging`.
+ */
+static acpi_rsdp1_t* acpi_find_rsdp(mb2_t* boot, uint64_t* xsdt) {
+    mb2_tag_rsdp2_t* tag2 = (mb2_tag_rsdp2_t*) mb2_find_tag(boot, MB2_TAG_RSDP2);
+
+    if (tag2) {
+        *xsdt = tag2->rsdp.xsdt_addr;
+        return &tag2->rsdp.rsdp1;
+    }
+
+    mb2_tag_rsdp1_t* tag1 = (mb2_tag_rsdp1_t*) mb2_find_tag(boot, MB2_TAG_RSDP1);
+
+    if (tag1) {
+        return &tag1->rsdp;
+    }
+
+    for (uintptr_t addr = ACPI_BIOS_BEGIN; addr < ACPI_BIOS_END; addr += 16) {
+        acpi_rsdp1_t* rsdp = (acpi_rsdp1_t*) addr;
+
+        if (!strncmp(rsdp->signature, "RSD PTR ", 8) &&
+                acpi_checksum(rsdp, sizeof(acpi_rsdp1_t))) {
+            if (rsdp->revision >= 2) {
+                *xsdt = ((acpi_rsdp2_t*) rsdp)->xsdt_addr;
+            }
+
+            return rsdp;
+        }
+    }
+
+    return NULL;
+}
+
+/* Maps the whole table at physical address `phys`, whose length we only know
+ * once its header is mapped. Returns NULL if its checksum is wrong.
+ */
+static acpi_header_t* acpi_map_table(uintptr_t phys) {
+    acpi_header_t* header = paging_map_mmio(phys, sizeof(acpi_header_t));
+
+    if (header->length < sizeof(acpi_header_t)) {
+        return NULL;
+    }
+
+    acpi_header_t* table = paging_map_mmio(phys, header->length);
+
+    return acpi_checksum(table, table->length) ? table : NULL;
+}
+
+/* ACPI structures are valid when their bytes sum up to zero.
+ */
+static bool acpi_checksum(const void* data, uint32_t size) {
+    uint8_t sum = 0;
+
+    for (uint32_t i = 0; i < size; i++) {
+        sum += ((uint8_t*) data)[i];
+    }
+
+    return sum == 0;
+}
+
+static void acpi_parse_madt(acpi_madt_t* madt) {
+    info.lapic_addr = madt->lapic_addr;
+
+    for (uint32_t irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        info.irq_gsi[irq] = irq;
+    }
+
+    uint8_t* entry = madt->entries;
+    uint8_t* end = (uint8_t*) madt + madt->header.length;
+
+    while (entry + sizeof(madt_entry_t) <= end) {
+        madt_entry_t* header = (madt_entry_t*) entry;
+
+        if (header->length < sizeof(madt_entry_t)) {
+            break;
+        }
+
+        if (header->type == MADT_LAPIC) {
+            madt_lapic_t* lapic = (madt_lapic_t*) entry;
+            bool enabled = lapic->flags & MADT_LAPIC_ENABLED;
+
+            if (enabled && info.num_cpus < MAX_CPUS) {
+                info.apic_ids[info.num_cpus++] = lapic->apic_id;
+            } else if (enabled) {
+                printke("ignoring CPU with APIC ID %d, too many CPUs", lapic->apic_id);
+            }
+        } else if (header->type == MADT_IOAPIC) {
+            madt_ioapic_t* ioapic = (madt_ioapic_t*) entry;
+
+            if (!info.ioapic_addr) {
+                info.ioapic_addr = ioapic->address;
+                info.ioapic_gsi_base = ioapic->gsi_base;
+            }
+        } else if (header->type == MADT_OVERRIDE) {
+            madt_override_t* override = (madt_override_t*) entry;
+
+            if (override->bus == 0 && override->source < ACPI_ISA_IRQS) {
+                info.irq_gsi[override->source] = override->gsi;
+                info.irq_flags[override->source] = override->flags;
+            }
+        }
+
+        entry += header->length;
+    }
+
+    found = info.num_cpus && info.ioapic_addr;
+
+    printk("found %d CPU(s)", info.num_cpus);
+}
@@ -0,0 +1,121 @@
+#include <kernel/clock.h>
+#include <kernel/com.h>
+#include <kernel/cpu.h>
+#include <kernel/pmm.h>
+#include <kernel/paging.h>
+#include <kernel/timer.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+
+#define PIT_2_GATE 0x61    // Bit 0 gates channel 2, bit 5 is its output
+#define PIT_2_ONESHOT 0xB0 // Channel 2, interrupt on terminal count
+#define CLOCK_CALIBRATION_HZ 100 // Calibrate over 10 ms
+
+#define NS_PER_SEC 1000000000ull
+
+static clock_page_t* clock_page;
+
+static uint64_t clock_calibrate();
+static void clock_start_countdown(uint32_t us);
+static bool clock_countdown_done();
+
+/* Sets up the clock page, which userspace can read, after measuring the
+ * frequency of the TSC against the PIT.
+ * Without a TSC, the clock falls back to counting timer ticks.
+ */
+void init_clock() {
+    clock_page = aligned_alloc(0x1000, 0x1000);
+    memset(clock_page, 0, 0x1000);
+
+    if (!(cpu_features() & CPUID_TSC)) {
+        printke("no TSC, the clock will have the timer's resolution");
+        return;
+    }
+
+    uint64_t hz = clock_calibrate();
+
+    if (hz < 1000000) {
+        printke("TSC calibration failed, the clock will have the timer's resolution");
+        return;
+    }
+
+    // Keep as many bits of precision as fit in `mult`
+    uint32_t shift = 32;
+
+    while (((NS_PER_SEC << shift) / hz) >> 32) {
+        shift--;
+    }
+
+    clock_page->mult = (NS_PER_SEC << shift) / hz;
+    clock_page->shift = shift;
+    clock_page->tsc_base = clock_read_tsc();
+
+    printk("TSC running at %d MHz", (uint32_t) (hz / 1000000));
+}
+
+/* Returns the time elapsed since `init_clock`, in nanoseconds.
+ */
+uint64_t clock_get_ns() {
+    if (!clock_page->mult) {
+        return timer_get_tick() * (NS_PER_SEC / TIMER_FREQ);
+    }
+
+    return clock_tsc_to_ns(clock_page, clock_read_tsc());
+}
+
+/* Busy-waits for `us` microseconds, up to 54925. This doesn't depend on
+ * `init_clock`, nor on interrupts.
+ */
+void clock_delay(uint32_t us) {
+    clock_start_countdown(us);
+
+    while (!clock_countdown_done()) { }
+}
+
+/* Returns the physical address of the clock page, with a new reference for
+ * the caller to map it in a process.
+ */
+uintptr_t clock_ref_page() {
+    uintptr_t phys = paging_virt_to_phys((uintptr_t) clock_page);
+    pmm_ref_page(phys);
+
+    return phys;
+}
+
+/* Counts TSC cycles while the PIT counts down a known duration. Returns the
+ * TSC's frequency.
+ */
+static uint64_t clock_calibrate() {
+    clock_start_countdown(1000000 / CLOCK_CALIBRATION_HZ);
+
+    uint64_t start = clock_read_tsc();
+
+    while (!clock_countdown_done()) { }
+
+    uint64_t end = clock_read_tsc();
+
+    return (end - start) * CLOCK_CALIBRATION_HZ;
+}
+
+/* Has channel 2 of the PIT, which doesn't raise interrupts, count down `us`
+ * microseconds.
+ */
+static void clock_start_countdown(uint32_t us) {
+    uint32_t counts = (uint64_t) TIMER_QUOTIENT * us / 1000000;
+
+    if (counts > 0xFFFF) {
+        counts = 0xFFFF;
+    }
+
+    // Enable the gate, but not the speaker
+    outportb(PIT_2_GATE, (inportb(PIT_2_GATE) & ~0x02) | 0x01);
+
+    outportb(PIT_CMD, PIT_2_ONESHOT);
+    outportb(PIT_2, counts & 0xFF);
+    outportb(PIT_2, (counts >> 8) & 0xFF);
+}
+
+static bool clock_countdown_done() {
+    return inportb(PIT_2_GATE) & 0x20;
+}
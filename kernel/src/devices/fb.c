@@ -7,9 +7,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-static fb_t fb;
+static fb_t fb; // The back buffer
+static fb_t vram; // The real framebuffer
 
 /* "fb" stands for "framebuffer" throughout the code.
+ * Everything is drawn to a back buffer in RAM, and only the parts that
+ * changed are copied to video memory, see `fb_flush`: it's slow to access,
+ * and the screen never shows a half-drawn frame.
  */
 void init_fb(mb2_t* boot) {
     mb2_tag_fb_t* fb_info = (mb2_tag_fb_t*) mb2_find_tag(boot, MB2_TAG_FB);
@@ -23,20 +27,50 @@ void init_fb(mb2_t* boot) {
         printke("unsupported bit depth: %d", fb.bpp);
     }
 
-    uintptr_t address = (uintptr_t) fb_info->addr;
+    uint32_t num_pages = divide_up(fb.height*fb.pitch, 0x1000);
 
-    // Remap our framebuffer
-    uint32_t size = fb.height*fb.pitch;
-    uintptr_t buff = (uintptr_t) kamalloc(size, 0x1000);
+    if (num_pages*0x1000 > KERNEL_FB_SIZE/2) {
+        printke("framebuffer too large: %dx%d", fb.width, fb.height);
+        abort();
+    }
+
+    // Remap our framebuffer, write-combining as it's only written to
+    vram = fb;
+    vram.address = KERNEL_FB_BEGIN;
+    paging_map_pages(vram.address, (uintptr_t) fb_info->addr, num_pages,
+        PAGE_RW | PAGE_WRITE_COMBINING);
+
+    // The back buffer is too large for the kernel heap
+    fb.address = KERNEL_FB_BEGIN + KERNEL_FB_SIZE/2;
 
-    for (uint32_t i = 0; i < size/0x1000; i++) {
-        page_t* p = paging_get_page(buff + 0x1000*i, false, 0);
-        *p = (address + 0x1000*i) | PAGE_PRESENT | PAGE_RW;
+    for (uint32_t i = 0; i < num_pages; i++) {
+        uintptr_t frame = pmm_alloc_page();
+
+        if (!frame) {
+            printke("no memory for the back buffer");
+            abort();
+        }
+
+        paging_map_page(fb.address + 0x1000*i, frame, PAGE_RW);
     }
 
-    fb.address = buff;
+    memset((void*) fb.address, 0, num_pages*0x1000);
 }
 
+/* Returns the back buffer.
+ */
 fb_t fb_get_info() {
     return fb;
-}
\ No newline at end of file
+}
+
+/* Copies a part of the back buffer to the screen. `rect` must be within it.
+ */
+void fb_flush(const wm_rect_t* rect) {
+    uint32_t off = rect->top*fb.pitch + rect->left*fb.bpp/8;
+    uint32_t len = (rect->right - rect->left + 1)*fb.bpp/8;
+
+    for (int32_t y = rect->top; y <= rect->bottom; y++) {
+        memcpy((void*) (vram.address + off), (void*) (fb.address + off), len);
+        off += fb.pitch;
+    }
+}
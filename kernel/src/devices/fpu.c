@@ -1,26 +1,56 @@
+#include <kernel/cpu.h>
 #include <kernel/fpu.h>
 #include <kernel/isr.h>
 #include <kernel/sys.h>
 
+#include <stdlib.h>
 #include <string.h>
 
 #define CR0_MP (1 << 1)
 #define CR0_EM (1 << 2)
+#define CR0_TS (1 << 3)
 #define CR4_OSFXSR (1 << 9)
 #define CR4_OSXMMEXCPT (1 << 10)
 
+// Offsets in the `fxsave` area
+#define FXSAVE_FCW 0
+#define FXSAVE_MXCSR 24
+
+// Values after `fninit`, and the default `mxcsr`, all exceptions masked
+#define FPU_DEFAULT_FCW 0x37F
+#define FPU_DEFAULT_MXCSR 0x1F80
+
 void fpu_exception_handler(registers_t* regs);
+void fpu_unavailable_handler(registers_t* regs);
 
-/* Instructions to read and write FPU context require a 16-bytes aligned buffer */
-static uint8_t kernel_fpu[512] __attribute__((aligned(16)));
+static void fpu_set_ts(bool set);
+
+/* The fpu state is switched lazily. It stays in the fpu, belonging to
+ * `fpu_owner`, while other processes run with the TS bit of CR0 set: their
+ * first fpu or SSE instruction raises a "device not available" exception,
+ * and only then is the owner's state saved and theirs restored.
+ * The kernel doesn't use the fpu, so that processes which don't either never
+ * pay for saving and restoring it.
+ * Each CPU has its own fpu; processes never leave their CPU.
+ */
+static process_t* fpu_owner[MAX_CPUS];
+static bool ts_set[MAX_CPUS];
 
 void init_fpu() {
+    isr_register_handler(7, fpu_unavailable_handler);
+    isr_register_handler(19, fpu_exception_handler);
+
+    fpu_init_cpu();
+}
+
+/* Enables the fpu of the current CPU.
+ */
+void fpu_init_cpu() {
     uint32_t cr;
 
     /* Configure CR0: disable emulation (EM), as we assume we have an FPU, and
-     * enable the EM bit: with the TS and EM bits disabled, `wait/fwait`
-     * instructions won't generate exceptions. This last part is desired
-     * because we save the FPU state on each task switch. */
+     * enable the MP bit: `wait/fwait` instructions then honor the TS bit too,
+     * which we use to switch fpu state lazily. */
     asm volatile(
         "clts\n"
         "mov %%cr0, %0" : "=r"(cr));
@@ -40,37 +70,90 @@ void init_fpu() {
         "mov %0, %%cr4\n"
         "fninit" ::"r"(cr));
 
-    isr_register_handler(19, fpu_exception_handler);
+    // Nobody owns the fpu yet
+    fpu_set_ts(true);
 }
 
-/* Whatever process got interrupted last has its fpu state in kernel_fpu.
- * When this function is called, it is being switched away from, hence we save
- * kernel_fpu in that process's structure, and we load the next process's fpu
- * state into kernel_fpu, which will get picked up by fpu_kernel_exit soon
- * enough.
+/* Called when switching processes: the fpu is made unavailable to `next`
+ * unless it holds its state already.
  */
 void fpu_switch(process_t* prev, const process_t* next) {
-    memcpy(prev->fpu_registers, kernel_fpu, 512);
-    memcpy(kernel_fpu, next->fpu_registers, 512);
+    UNUSED(prev);
+
+    fpu_set_ts(next != fpu_owner[cpu_get_id()]);
+}
+
+/* Gives a new process the state `fninit` would, with SSE exceptions masked.
+ */
+void fpu_init_process(process_t* process) {
+    memset(process->fpu_registers, 0, sizeof(process->fpu_registers));
+    *(uint16_t*) &process->fpu_registers[FXSAVE_FCW] = FPU_DEFAULT_FCW;
+    *(uint32_t*) &process->fpu_registers[FXSAVE_MXCSR] = FPU_DEFAULT_MXCSR;
 }
 
-/* Called when execution enters the kernel: the fpu state is saved, then
- * cleared, so the kernel gets a fresh start.
+/* Gives `child` a copy of the fpu state of the current process, of which it
+ * is a copy.
  */
-void fpu_kernel_enter() {
-    asm volatile (
-        "fxsave (%0)\n"
-        "fninit\n" :: "r" (kernel_fpu));
+void fpu_fork(process_t* child) {
+    process_t* current = proc_get_current();
+
+    if (current == fpu_owner[cpu_get_id()]) {
+        fpu_set_ts(false);
+        asm volatile("fxsave (%0)" :: "r"(child->fpu_registers) : "memory");
+    } else {
+        memcpy(child->fpu_registers, current->fpu_registers, sizeof(child->fpu_registers));
+    }
 }
 
-/* Restores the process's fpu state upon returning from the kernel.
+/* Forgets the fpu state of an exiting process.
  */
-void fpu_kernel_exit() {
-    asm volatile ("fxrstor (%0)" :: "r" (kernel_fpu));
+void fpu_exit(process_t* process) {
+    if (process == fpu_owner[process->cpu]) {
+        fpu_owner[process->cpu] = NULL;
+    }
+}
+
+/* The current process used the fpu while someone else's state was loaded.
+ */
+void fpu_unavailable_handler(registers_t* regs) {
+    process_t* current = proc_get_current();
+    process_t** owner = &fpu_owner[cpu_get_id()];
+
+    if ((regs->cs & 3) != 3) {
+        printke("the kernel used the fpu at %p", regs->eip);
+        abort();
+    }
+
+    fpu_set_ts(false);
+
+    if (*owner) {
+        asm volatile("fxsave (%0)" :: "r"((*owner)->fpu_registers) : "memory");
+    }
+
+    asm volatile("fxrstor (%0)" :: "r"(current->fpu_registers));
+    *owner = current;
 }
 
 void fpu_exception_handler(registers_t* regs) {
     UNUSED(regs);
 
     printke("an exception occured");
-}
\ No newline at end of file
+}
+
+static void fpu_set_ts(bool set) {
+    uint32_t cpu = cpu_get_id();
+
+    if (set == ts_set[cpu]) {
+        return;
+    }
+
+    if (set) {
+        uint32_t cr0;
+        asm volatile("mov %%cr0, %0" : "=r"(cr0));
+        asm volatile("mov %0, %%cr0" :: "r"(cr0 | CR0_TS));
+    } else {
+        asm volatile("clts");
+    }
+
+    ts_set[cpu] = set;
+}
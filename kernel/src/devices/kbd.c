@@ -2,6 +2,7 @@
 #include <kernel/ps2.h>
 #include <kernel/irq.h>
 #include <kernel/sys.h>
+#include <kernel/work.h>
 
 #include <stdio.h>
 #include <ctype.h>
@@ -63,6 +64,13 @@ static bool key_states[256] = { false };
 static kbd_event_t next_event;
 static kbd_callback_t callback;
 
+// Events wait here for `kbd_work` to pass them on to `callback`
+static kbd_event_t events[32];
+static work_ring_t event_ring = WORK_RING_INIT(events);
+
+static void kbd_work();
+static work_t work = WORK_INIT(kbd_work);
+
 void init_kbd(uint32_t dev) {
     device = dev;
     context = (kbd_context_t) {
@@ -126,8 +134,21 @@ void kbd_handler(registers_t* regs) {
 
     next_event.repr = kbd_keycode_to_char(next_event.keycode, context.shift);
 
-    if (callback) {
-        callback(next_event);
+    // Dropped if nobody's keeping up
+    work_ring_push(&event_ring, &next_event);
+    work_schedule(&work);
+}
+
+/* Passes the events received since the last call on to the callback, outside
+ * of the interrupt handler.
+ */
+static void kbd_work() {
+    kbd_event_t event;
+
+    while (work_ring_pop(&event_ring, &event)) {
+        if (callback) {
+            callback(event);
+        }
     }
 }
 
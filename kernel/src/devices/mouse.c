@@ -1,6 +1,7 @@
 #include <kernel/mouse.h>
 #include <kernel/irq.h>
 #include <kernel/sys.h>
+#include <kernel/work.h>
 
 #include <stdio.h>
 
@@ -13,6 +14,13 @@ mouse_t state;
 
 mouse_callback_t callback;
 
+// States wait here for `mouse_work` to pass them on to `callback`
+static mouse_t states[64];
+static work_ring_t state_ring = WORK_RING_INIT(states);
+
+static void mouse_work();
+static work_t work = WORK_INIT(mouse_work);
+
 /* Initializes a mouse plugged in controller `dev`.
  * Tries to enable as many of its features as possible.
  */
@@ -68,6 +76,12 @@ bool mouse_states_equal(mouse_t* a, mouse_t* b) {
            a->right_pressed == b->right_pressed;
 }
 
+bool mouse_buttons_equal(mouse_t* a, mouse_t* b) {
+    return a->left_pressed == b->left_pressed &&
+           a->middle_pressed == b->middle_pressed &&
+           a->right_pressed == b->right_pressed;
+}
+
 void mouse_handle_packet() {
     mouse_t old_state = state;
 
@@ -106,8 +120,29 @@ void mouse_handle_packet() {
     state.x += delta_x;
     state.y -= delta_y; // Point the y-axis downward
 
-    if (!mouse_states_equal(&old_state, &state) && callback) {
-        callback(state);
+    if (!mouse_states_equal(&old_state, &state)) {
+        // Dropped if nobody's keeping up
+        work_ring_push(&state_ring, &state);
+        work_schedule(&work);
+    }
+}
+
+/* Passes the states received since the last call on to the callback, outside
+ * of the interrupt handler. Movements are coalesced: only the last position
+ * before each change of buttons is passed on, so that the window manager
+ * redraws once for all the packets that came in since it last did.
+ */
+static void mouse_work() {
+    mouse_t curr, next;
+
+    while (work_ring_pop(&state_ring, &curr)) {
+        while (work_ring_peek(&state_ring, &next) && mouse_buttons_equal(&curr, &next)) {
+            work_ring_pop(&state_ring, &curr);
+        }
+
+        if (callback) {
+            callback(curr);
+        }
     }
 }
 
@@ -1,27 +1,74 @@
 #include <kernel/timer.h>
+#include <kernel/apic.h>
 #include <kernel/com.h>
+#include <kernel/cpu.h>
+#include <kernel/slab.h>
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <list.h>
 
+/* Ticks come from the PIT, or from the local APIC timer of each CPU when
+ * there's an APIC, see `smp_timer_handler`: the bootstrap processor's then
+ * keeps time, while other CPUs' ticks only run their scheduler.
+ * In one-shot mode, a CPU's timer fires once after `oneshot_counts` of its
+ * cycles instead of on every tick. On the bootstrap processor, cycles that
+ * don't make up a whole tick are kept in `residual_counts` so that time
+ * doesn't drift.
+ */
+typedef struct {
+    bool oneshot;
+    uint32_t oneshot_counts;
+    bool skip_tick; // When an interrupt was already accounted for
+} timer_cpu_t;
+
 static uint32_t current_tick;
 static list_t callbacks;
+static kmem_cache_t* callback_cache;
+
+static timer_cpu_t timers[MAX_CPUS];
+static uint32_t residual_counts;
+static uint32_t tick_counts; // Timer cycles per tick
+static uint32_t max_oneshot_ticks;
+static volatile uint32_t deadline; // When the bootstrap processor's one-shot fires
+
+static void timer_account(uint32_t counts);
+static void timer_program(bool periodic, uint32_t counts);
+static uint32_t timer_get_left();
 
 void init_timer() {
     callbacks = LIST_HEAD_INIT(callbacks);
+    callback_cache = kmem_cache_create("timer_callback", sizeof(handler_t));
 
-    irq_register_handler(IRQ0, &timer_callback);
-
-    uint32_t divisor = TIMER_QUOTIENT / TIMER_FREQ;
+    if (apic_enabled()) {
+        tick_counts = apic_get_timer_counts();
+        max_oneshot_ticks = UINT32_MAX / tick_counts;
+    } else {
+        tick_counts = TIMER_DIVISOR;
+        max_oneshot_ticks = PIT_MAX_ONESHOT_TICKS;
+        irq_register_handler(IRQ0, &timer_callback);
+    }
 
-    outportb(PIT_CMD, PIT_SET);
-    outportb(PIT_0, divisor & 0xFF);
-    outportb(PIT_0, (divisor >> 8) & 0xFF);
+    timer_program(true, tick_counts);
 }
 
+/* Called on the bootstrap processor's ticks.
+ */
 void timer_callback(registers_t* regs) {
-    current_tick++;
+    timer_cpu_t* timer = &timers[0];
+
+    if (timer->oneshot) {
+        // This may be a periodic tick, pending since before the switch to
+        // one-shot mode. Only the local APIC tells what's left in that case.
+        uint32_t left = apic_enabled() ? timer_get_left() : 0;
+
+        timer_account(timer->oneshot_counts - left);
+        timer->oneshot_counts = left;
+    } else if (timer->skip_tick) {
+        timer->skip_tick = false;
+    } else {
+        current_tick++;
+    }
 
     handler_t* callback;
     list_for_each_entry(callback, &callbacks) {
@@ -33,29 +80,113 @@ uint32_t timer_get_tick() {
     return current_tick;
 }
 
-/* Returns the time since boot in seconds
- */
-float timer_get_time() {
-    return current_tick * (1.0f / TIMER_FREQ);
-}
-
 /* Registers a callback to be called on each timer tick.
  */
 void timer_register_callback(handler_t handler) {
-    handler_t* callback = (handler_t*) kmalloc(sizeof(handler_t));
+    handler_t* callback = (handler_t*) kmem_cache_alloc(callback_cache);
     *callback = handler;
 
     list_add(&callbacks, callback);
 }
 
+/* Stops the periodic tick of the current CPU: its timer will only fire once,
+ * `ticks` ticks from now, or as late as the hardware allows.
+ * Meant for when the CPU is idle, see `proc_idle`.
+ */
+void timer_set_oneshot(uint32_t ticks) {
+    timer_cpu_t* timer = &timers[cpu_get_id()];
+
+    if (timer->oneshot && timer->oneshot_counts) {
+        timer_set_periodic();
+    }
+
+    if (ticks > max_oneshot_ticks) {
+        ticks = max_oneshot_ticks;
+    }
+
+    if (timer == &timers[0]) {
+        deadline = current_tick + ticks;
+    }
+
+    timer->oneshot = true;
+    timer->oneshot_counts = ticks*tick_counts;
+    timer_program(false, timer->oneshot_counts);
+}
+
+/* Goes back to ticking regularly, accounting for the time spent in one-shot
+ * mode if we're leaving it early.
+ */
+void timer_set_periodic() {
+    timer_cpu_t* timer = &timers[cpu_get_id()];
+
+    if (!timer->oneshot) {
+        return;
+    }
+
+    if (timer == &timers[0] && timer->oneshot_counts) {
+        uint32_t counts = timer->oneshot_counts;
+        uint32_t left = timer_get_left();
+
+        // The counter wraps around once it's done, and its interrupt may be
+        // pending. The local APIC's stops at zero, telling us it is.
+        timer_account(left <= counts ? counts - left : counts);
+        timer->skip_tick = apic_enabled() && !left;
+    }
+
+    timer->oneshot = false;
+    timer->oneshot_counts = 0;
+    timer_program(true, tick_counts);
+}
+
+/* Returns whether the bootstrap processor, which keeps time, will have ticked
+ * by `tick`: it may be waiting for longer in one-shot mode, in which case
+ * it should be woken up to wait for less.
+ */
+bool timer_ticks_by(uint32_t tick) {
+    timer_cpu_t* timer = &timers[0];
+
+    return !timer->oneshot || !timer->oneshot_counts || (int32_t) (deadline - tick) <= 0;
+}
+
 void timer_remove_callback(handler_t handler) {
     list_t* iter;
     handler_t* callback;
     list_for_each(iter, callback, &callbacks) {
         if (*callback == handler) {
             list_del(iter);
-            kfree(callback);
+            kmem_cache_free(callback_cache, callback);
             return;
         }
     }
-}
\ No newline at end of file
+}
+
+static void timer_account(uint32_t counts) {
+    residual_counts += counts;
+    current_tick += residual_counts / tick_counts;
+    residual_counts %= tick_counts;
+}
+
+static void timer_program(bool periodic, uint32_t counts) {
+    if (apic_enabled()) {
+        apic_set_timer(periodic, counts);
+        return;
+    }
+
+    outportb(PIT_CMD, periodic ? PIT_SET : PIT_ONESHOT);
+    outportb(PIT_0, counts & 0xFF);
+    outportb(PIT_0, (counts >> 8) & 0xFF);
+}
+
+/* Returns how many cycles the current CPU's timer has left to count.
+ */
+static uint32_t timer_get_left() {
+    if (apic_enabled()) {
+        return apic_get_timer_left();
+    }
+
+    outportb(PIT_CMD, PIT_LATCH);
+    uint32_t left = inportb(PIT_0);
+    left |= inportb(PIT_0) << 8;
+
+    return left;
+}
@@ -1,7 +1,11 @@
+#include <kernel/acpi.h>
+#include <kernel/apic.h>
+#include <kernel/clock.h>
 #include <kernel/ext2.h>
 #include <kernel/fb.h>
 #include <kernel/fpu.h>
 #include <kernel/fs.h>
+#include <kernel/futex.h>
 #include <kernel/gdt.h>
 #include <kernel/idt.h>
 #include <kernel/irq.h>
@@ -11,12 +15,15 @@
 #include <kernel/proc.h>
 #include <kernel/ps2.h>
 #include <kernel/serial.h>
+#include <kernel/slab.h>
+#include <kernel/smp.h>
 #include <kernel/stacktrace.h>
 #include <kernel/sys.h>
 #include <kernel/syscall.h>
 #include <kernel/term.h>
 #include <kernel/timer.h>
 #include <kernel/wm.h>
+#include <kernel/work.h>
 
 #include <assert.h>
 #include <stdint.h>
@@ -39,6 +46,7 @@ void kernel_main(mb2_t* boot, uint32_t magic) {
 
     init_pmm(boot);
     init_paging(boot);
+    init_slab();
 
     printk("SnowflakeOS 0.7");
     printk("kernel is %d KiB large", ((uint32_t) &KERNEL_SIZE) >> 10);
@@ -48,9 +56,12 @@ void kernel_main(mb2_t* boot, uint32_t magic) {
     init_idt();
     init_isr();
     init_irq();
+    init_acpi(boot);
+    init_apic();
     init_syscall();
 
     init_timer();
+    init_clock();
     init_ps2();
 
     // Load GRUB modules as programs
@@ -77,8 +88,14 @@ void kernel_main(mb2_t* boot, uint32_t magic) {
         tag = (mb2_tag_t*) ((uintptr_t) tag + align_to(tag->size, 8));
     }
 
-    init_wm();
-    init_proc();
+    mb2_tag_cmdline_t* cmdline_tag = (mb2_tag_cmdline_t*) mb2_find_tag(boot, MB2_TAG_CMDLINE);
+    char* cmdline = cmdline_tag ? (char*) cmdline_tag->cmdline : NULL;
+
+    init_smp(cmdline);
+    init_proc(cmdline);
+    init_futex();
+    init_work();
+    init_wm(cmdline);
 
     proc_exec("/background", NULL);
     proc_exec("/terminal", NULL);
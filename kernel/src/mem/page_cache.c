@@ -0,0 +1,119 @@
+#include <kernel/page_cache.h>
+#include <kernel/paging.h>
+#include <kernel/pmm.h>
+#include <kernel/slab.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_CACHE_BUCKETS 256
+
+/* The page cache keeps the contents of file pages in physical frames, so that
+ * they can be mapped directly in processes, e.g. executables, instead of
+ * being read again.
+ * The cache holds a reference to each of its frames; users of
+ * `page_cache_get` get one too, and must map the frame read-only if they
+ * don't want to modify the cached contents.
+ */
+typedef struct _page_cache_entry_t {
+    fs_t* fs;
+    uint32_t inode_no;
+    uint32_t index; // Offset in the file, in pages
+    uintptr_t frame;
+    struct _page_cache_entry_t* next;
+} page_cache_entry_t;
+
+static page_cache_entry_t* buckets[PAGE_CACHE_BUCKETS];
+static kmem_cache_t* entry_cache;
+
+static uint32_t page_cache_hash(fs_t* fs, uint32_t inode_no, uint32_t index) {
+    return ((uintptr_t) fs + inode_no*31 + index*131) % PAGE_CACHE_BUCKETS;
+}
+
+/* Returns the frame holding the `index`-th page of the given file, reading it
+ * in if needed. Bytes past the end of the file are zero.
+ * A reference to the frame is added on behalf of the caller.
+ */
+uintptr_t page_cache_get(fs_t* fs, uint32_t inode_no, uint32_t index) {
+    uint32_t h = page_cache_hash(fs, inode_no, index);
+
+    for (page_cache_entry_t* e = buckets[h]; e; e = e->next) {
+        if (e->fs == fs && e->inode_no == inode_no && e->index == index) {
+            pmm_ref_page(e->frame);
+            return e->frame;
+        }
+    }
+
+    if (!entry_cache) {
+        entry_cache = kmem_cache_create("page_cache", sizeof(page_cache_entry_t));
+    }
+
+    // Read the page through a temporary mapping of its frame
+    uintptr_t frame = pmm_alloc_page();
+    uint8_t* page = paging_map_temp(frame);
+    uint32_t read = fs->read(fs, inode_no, index*0x1000, page, 0x1000);
+    memset(page + read, 0, 0x1000 - read);
+
+    page_cache_entry_t* e = kmem_cache_alloc(entry_cache);
+
+    *e = (page_cache_entry_t) {
+        .fs = fs,
+        .inode_no = inode_no,
+        .index = index,
+        .frame = frame,
+        .next = buckets[h]
+    };
+
+    buckets[h] = e;
+    pmm_ref_page(frame);
+
+    return frame;
+}
+
+/* Drops the cached pages of a file, which must be called when it's modified.
+ * Processes that mapped those pages keep their own references.
+ */
+void page_cache_invalidate(fs_t* fs, uint32_t inode_no) {
+    for (uint32_t h = 0; h < PAGE_CACHE_BUCKETS; h++) {
+        page_cache_entry_t** link = &buckets[h];
+
+        while (*link) {
+            page_cache_entry_t* e = *link;
+
+            if (e->fs == fs && e->inode_no == inode_no) {
+                *link = e->next;
+                pmm_unref_page(e->frame);
+                kmem_cache_free(entry_cache, e);
+            } else {
+                link = &e->next;
+            }
+        }
+    }
+}
+
+/* Frees the cached pages that aren't mapped anywhere. Returns the number of
+ * pages freed.
+ */
+uint32_t page_cache_reclaim() {
+    uint32_t freed = 0;
+
+    for (uint32_t h = 0; h < PAGE_CACHE_BUCKETS; h++) {
+        page_cache_entry_t** link = &buckets[h];
+
+        while (*link) {
+            page_cache_entry_t* e = *link;
+
+            if (pmm_get_refcount(e->frame) == 1) {
+                *link = e->next;
+                pmm_free_page(e->frame);
+                kmem_cache_free(entry_cache, e);
+                freed++;
+            } else {
+                link = &e->next;
+            }
+        }
+    }
+
+    return freed;
+}
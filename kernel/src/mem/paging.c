@@ -1,6 +1,8 @@
+#include <kernel/cpu.h>
 #include <kernel/paging.h>
 #include <kernel/pmm.h>
 #include <kernel/proc.h>
+#include <kernel/smp.h>
 #include <kernel/stacktrace.h>
 #include <kernel/sys.h>
 #include <kernel/term.h>
@@ -13,7 +15,16 @@
 #define DIRECTORY_INDEX(x) ((x) >> 22)
 #define TABLE_INDEX(x) (((x) >> 12) & 0x3FF)
 
+#define CR0_WP (1 << 16)
+
+// Memory type of the PAT entry selected by `PAGE_WRITE_COMBINING`
+#define PAT_WRITE_COMBINING 0x01
+#define PAT_ENTRY_SHIFT 8
+
+#define SHARED_PAGES (KERNEL_SHARED_SIZE / 0x1000)
+
 static directory_entry_t* current_page_directory;
+static uint32_t shared_pages[SHARED_PAGES / 32]; // Bitmap of used pages
 
 extern directory_entry_t kernel_directory[1024];
 
@@ -32,6 +43,40 @@ void init_paging(mb2_t* boot) {
     paging_map_pages(0x00000000, 0x00000000, to_map, PAGE_RW);
     paging_invalidate_page(0x00000000);
     current_page_directory = kernel_directory;
+
+    // Create the temporary page's table now so that every process shares it,
+    // the same goes for the MMIO area
+    paging_get_page(KERNEL_TEMP_PAGE, true, PAGE_RW);
+    paging_get_page(KERNEL_MMIO_BEGIN, true, PAGE_RW);
+
+    for (uintptr_t addr = KERNEL_SHARED_BEGIN; addr < KERNEL_SHARED_BEGIN + KERNEL_SHARED_SIZE; addr += 0x400000) {
+        paging_get_page(addr, true, PAGE_RW);
+    }
+
+    // Have the kernel fault when writing to read-only user pages too, for
+    // copy-on-write to work for data written by syscalls
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    asm volatile("mov %0, %%cr0" :: "r"(cr0 | CR0_WP));
+
+    paging_init_cpu();
+}
+
+/* Makes pages mapped with `PAGE_WRITE_COMBINING` write-combining on the
+ * current CPU, if it has a page attribute table: writes to them are buffered
+ * and sent in bursts, which suits the framebuffer. Every CPU must do this.
+ * The PAT entry selected by PWT alone is write-through by default, and no
+ * page uses it before this is called: caches needn't be flushed.
+ */
+void paging_init_cpu() {
+    if (!(cpu_features() & CPUID_PAT)) {
+        return;
+    }
+
+    uint64_t pat = cpu_read_msr(MSR_PAT);
+    pat &= ~((uint64_t) 0xFF << PAT_ENTRY_SHIFT);
+    pat |= (uint64_t) PAT_WRITE_COMBINING << PAT_ENTRY_SHIFT;
+    cpu_write_msr(MSR_PAT, pat);
 }
 
 uintptr_t paging_get_kernel_directory() {
@@ -89,9 +134,21 @@ void paging_map_page(uintptr_t virt, uintptr_t phys, uint32_t flags) {
 void paging_unmap_page(uintptr_t virt) {
     page_t* page = paging_get_page(virt, false, 0);
 
-    if (page) {
-        pmm_free_page(*page & PAGE_FRAME);
+    if (page && *page & PAGE_PRESENT) {
+        uintptr_t frame = *page & PAGE_FRAME;
+
         *page = 0;
+        paging_invalidate_page(virt);
+
+        // Kernel mappings are shared by every CPU, which may have cached it,
+        // and user ones by the threads of the process
+        if (virt >= KERNEL_BASE_VIRT) {
+            smp_flush_tlbs();
+        } else {
+            smp_flush_user_tlbs();
+        }
+
+        pmm_unref_page(frame);
     }
 }
 
@@ -136,6 +193,12 @@ void paging_fault_handler(registers_t* regs) {
     uintptr_t cr2 = 0;
     asm volatile("mov %%cr2, %0\n" : "=r"(cr2));
 
+    // The page may have been reserved by the process without being backed yet,
+    // or be a copy-on-write page
+    if (proc_handle_fault(cr2, err)) {
+        return;
+    }
+
     printke("page fault caused by instruction at %p from process %d:",
         regs->eip, pid);
     printke("the page at %p %s present ", cr2, err & 0x01 ? "was" : "wasn't");
@@ -163,7 +226,7 @@ void paging_fault_handler(registers_t* regs) {
     }
 
     if (pid) {
-        proc_exit();
+        proc_exit(-1);
     } else {
         abort();
     }
@@ -198,4 +261,83 @@ uintptr_t paging_virt_to_phys(uintptr_t virt) {
     }
 
     return (((uintptr_t)*p) & PAGE_FRAME) + (virt & 0xFFF);
-}
\ No newline at end of file
+}
+/* Maps the physical page `phys` at a fixed kernel address, which is returned.
+ * The mapping only lasts until the next call.
+ */
+void* paging_map_temp(uintptr_t phys) {
+    page_t* page = paging_get_page(KERNEL_TEMP_PAGE, false, 0);
+
+    *page = phys | PAGE_PRESENT | PAGE_RW;
+    paging_invalidate_page(KERNEL_TEMP_PAGE);
+
+    return (void*) KERNEL_TEMP_PAGE;
+}
+
+/* Maps `size` bytes of physical memory starting at `phys`, which needn't be
+ * page-aligned, in the MMIO area, uncached. Returns the matching virtual
+ * address. Mappings are permanent: this is meant for device registers and
+ * firmware tables found at boot.
+ */
+void* paging_map_mmio(uintptr_t phys, uint32_t size) {
+    static uintptr_t next = KERNEL_MMIO_BEGIN;
+
+    uint32_t offset = phys & ~PAGE_FRAME;
+    uint32_t num = divide_up(offset + size, 0x1000);
+
+    if (next + num*0x1000 > KERNEL_MMIO_BEGIN + KERNEL_MMIO_SIZE) {
+        printke("out of MMIO space");
+        abort();
+    }
+
+    uintptr_t virt = next;
+    paging_map_pages(virt, phys & PAGE_FRAME, num, PAGE_RW | PAGE_NOCACHE);
+    next += num*0x1000;
+
+    return (void*) (virt + offset);
+}
+
+/* Maps `num` zeroed pages contiguously in the shared area, for them to be
+ * mapped in a process too, see `proc_map_shared`. Returns NULL if there isn't
+ * enough room.
+ */
+void* paging_alloc_shared(uint32_t num) {
+    uint32_t run = 0;
+
+    for (uint32_t i = 0; i < SHARED_PAGES && num; i++) {
+        run = shared_pages[i / 32] & (1 << (i % 32)) ? 0 : run + 1;
+
+        if (run < num) {
+            continue;
+        }
+
+        uint32_t first = i + 1 - num;
+        uintptr_t virt = KERNEL_SHARED_BEGIN + first*0x1000;
+
+        for (uint32_t j = first; j <= i; j++) {
+            shared_pages[j / 32] |= 1 << (j % 32);
+            paging_map_page(KERNEL_SHARED_BEGIN + j*0x1000, pmm_alloc_page(), PAGE_RW);
+        }
+
+        memset((void*) virt, 0, num*0x1000);
+
+        return (void*) virt;
+    }
+
+    printke("out of shared space");
+
+    return NULL;
+}
+
+/* Unmaps pages mapped by `paging_alloc_shared`. They're only freed once
+ * every process they were mapped in has unmapped them too.
+ */
+void paging_free_shared(void* addr, uint32_t num) {
+    uint32_t first = ((uintptr_t) addr - KERNEL_SHARED_BEGIN) / 0x1000;
+
+    paging_unmap_pages((uintptr_t) addr, num);
+
+    for (uint32_t j = first; j < first + num; j++) {
+        shared_pages[j / 32] &= ~(1 << (j % 32));
+    }
+}
@@ -1,6 +1,8 @@
 #include <kernel/multiboot2.h>
+#include <kernel/page_cache.h>
 #include <kernel/paging.h>
 #include <kernel/pmm.h>
+#include <kernel/spinlock.h>
 #include <kernel/sys.h>
 
 #include <math.h>
@@ -8,23 +10,62 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define NTHBIT(n) ((uint32_t) 1 << n)
+#define PMM_NONE 0xFFFFFFFF
+#define PMM_MAX_FRAMES (1024 * 1024) // 4 GiB worth of frames
+#define PMM_FRAME_TABLES (PMM_MAX_FRAMES * sizeof(pmm_frame_t) / 0x400000)
 
-static uint32_t bitmap[1024 * 1024 / 32];
-static uint32_t mem_size;
-static uint32_t used_blocks;
+// Set on the first frame of a block that sits in a free list
+#define PMM_FRAME_FREE 1
+
+/* Physical memory is handed out by a binary buddy allocator: free memory is
+ * kept as naturally aligned blocks of 2^order frames, one free list per order.
+ * The buddy of a block is found by flipping bit `order` of the index of its
+ * first frame, which makes both splitting and coalescing cheap.
+ * Bookkeeping is done in one `pmm_frame_t` per frame of physical memory; list
+ * links and order are only meaningful for the first frame of a free block,
+ * and the reference count for allocated frames.
+ */
+typedef struct {
+    uint32_t next;
+    uint32_t prev;
+    uint8_t order;
+    uint8_t flags;
+    uint16_t refcount;
+} pmm_frame_t;
+
+/* The frame array is mapped after the kernel heap by page tables of our own,
+ * which are part of the kernel directory before any process copies it.
+ */
+static page_t frame_tables[PMM_FRAME_TABLES][1024] __attribute__((aligned(4096)));
+static pmm_frame_t* frames = (pmm_frame_t*) PMM_FRAMES_BEGIN;
+
+static uint32_t free_lists[PMM_MAX_ORDER + 1];
+static uint32_t num_frames;
+static uint32_t free_frames;
 static uint32_t max_blocks;
+static uint32_t mem_size;
 static uintptr_t kernel_end;
+static uintptr_t frames_phys_end;
+
+// Guards the free lists and reference counts, which any CPU may modify
+static spinlock_t pmm_lock = SPINLOCK_INIT;
 
 // Linker-provided symbols. Beware, those don't take into account GRUB's things
 extern uint32_t KERNEL_END;
 extern uint32_t KERNEL_END_PHYS;
 
-void mmap_set(uint32_t bit);
-void mmap_unset(uint32_t bit);
-uint32_t mmap_test(uint32_t bit);
-uint32_t mmap_find_free();
-uint32_t mmap_find_free_frame(uint32_t num);
+extern directory_entry_t kernel_directory[1024];
+
+static uintptr_t pmm_find_frames_location(mb2_t* boot, uint32_t size);
+static void pmm_map_frames(uintptr_t phys, uint32_t size);
+static void list_push(uint32_t frame, uint32_t order);
+static void list_remove(uint32_t frame, uint32_t order);
+static uint32_t buddy_alloc(uint32_t order);
+static void buddy_free(uint32_t frame, uint32_t order);
+static void buddy_reserve(uint32_t frame);
+static void free_range(uint32_t frame, uint32_t num);
+static uint32_t order_for(uint32_t num);
+static void free_frame(uint32_t block);
 
 void init_pmm(mb2_t* boot) {
     // Compute where the kernel & GRUB modules end in physical memory
@@ -50,10 +91,7 @@ void init_pmm(mb2_t* boot) {
         abort();
     }
 
-    // Prepare our block allocation bitmap
-    memset(bitmap, 0xFF, sizeof(bitmap)); // Blocks are taken by default
-
-    // Parse the memory map to mark valid areas as available
+    // Find out how much physical memory we have to keep track of
     uint64_t available = 0;
     uint64_t unavailable = 0;
 
@@ -62,7 +100,16 @@ void init_pmm(mb2_t* boot) {
 
     while ((uintptr_t) ent < (uintptr_t) mmap + mmap->header.size) {
         if (ent->type == MB2_MMAP_AVAIL) {
-            pmm_init_region((uintptr_t) ent->base_addr, ent->length);
+            uint64_t end_frame = (ent->base_addr + ent->length) / PMM_BLOCK_SIZE;
+
+            if (end_frame > PMM_MAX_FRAMES) {
+                end_frame = PMM_MAX_FRAMES;
+            }
+
+            if (end_frame > num_frames) {
+                num_frames = end_frame;
+            }
+
             available += ent->length;
         } else {
             unavailable += ent->length;
@@ -71,13 +118,47 @@ void init_pmm(mb2_t* boot) {
         ent = (mb2_mmap_entry_t*) ((uintptr_t) ent + mmap->entry_size);
     }
 
+    // Setup the frame array, every frame starts out as used
+    uint32_t frames_size = num_frames * sizeof(pmm_frame_t);
+    uintptr_t frames_phys = pmm_find_frames_location(boot, frames_size);
+
+    if (!frames_phys) {
+        printke("no room for the physical memory manager's frame array");
+        abort();
+    }
+
+    pmm_map_frames(frames_phys, frames_size);
+    memset(frames, 0, frames_size);
+    frames_phys_end = frames_phys + frames_size;
+
+    for (uint32_t i = 0; i <= PMM_MAX_ORDER; i++) {
+        free_lists[i] = PMM_NONE;
+    }
+
+    // Parse the memory map to mark valid areas as available
+    ent = mmap->entries;
+
+    while ((uintptr_t) ent < (uintptr_t) mmap + mmap->header.size) {
+        // Memory above 4 GiB isn't addressable without PAE
+        if (ent->type == MB2_MMAP_AVAIL && ent->base_addr < 0x100000000) {
+            uint64_t length = ent->length;
+
+            if (ent->base_addr + length > 0x100000000) {
+                length = 0x100000000 - ent->base_addr;
+            }
+
+            pmm_init_region((uintptr_t) ent->base_addr, length);
+        }
+
+        ent = (mb2_mmap_entry_t*) ((uintptr_t) ent + mmap->entry_size);
+    }
+
     mem_size = available;
-    max_blocks = mem_size / PMM_BLOCK_SIZE;
-    used_blocks = max_blocks;
 
-    // Protect low memory, our glorious kernel and its modules
+    // Protect low memory, our glorious kernel and its modules, the frame array
     pmm_deinit_region(0, kernel_end);
     pmm_deinit_region((uintptr_t) boot, boot->total_size);
+    pmm_deinit_region(frames_phys, frames_size);
 
     printk("memory stats: available: \x1B[32m%d MiB\x1B[0m", available >> 20);
     printk("unavailable: \x1B[32m%d KiB\x1B[0m", unavailable >> 10);
@@ -88,7 +169,7 @@ void init_pmm(mb2_t* boot) {
 /* Returns the number of bytes allocated by the PMM.
  */
 uint32_t pmm_used_memory() {
-    return used_blocks * PMM_BLOCK_SIZE;
+    return (max_blocks - free_frames) * PMM_BLOCK_SIZE;
 }
 
 /* Returns the number of free bytes the PMM started with.
@@ -97,19 +178,24 @@ uint32_t pmm_total_memory() {
     return mem_size;
 }
 
-/* Mark an area of physical memory as available.
+/* Mark an area of physical memory as available. Only frames entirely
+ * contained in the area are considered, and they must not be available
+ * already.
  */
 void pmm_init_region(uintptr_t addr, uint32_t size) {
-    uint32_t base_block = addr/PMM_BLOCK_SIZE;
-    /* A region might be smaller than a block, yet span two: boundaries */
-    uint32_t num = divide_up(size + addr % PMM_BLOCK_SIZE, PMM_BLOCK_SIZE);
+    uint32_t first = divide_up(addr, PMM_BLOCK_SIZE);
+    uint32_t last = ((uint64_t) addr + size) / PMM_BLOCK_SIZE;
 
-    while (num-- > 0) {
-        mmap_unset(base_block++);
+    if (last > num_frames) {
+        last = num_frames;
     }
 
-    // Never map the nullptr
-    mmap_set(0);
+    if (last <= first) {
+        return;
+    }
+
+    free_range(first, last - first);
+    max_blocks += last - first;
 }
 
 /* Mark an area of physical memory as used.
@@ -118,8 +204,8 @@ void pmm_deinit_region(uintptr_t addr, uint32_t size) {
     uint32_t base_block = addr/PMM_BLOCK_SIZE;
     uint32_t num = divide_up(size + addr % PMM_BLOCK_SIZE, PMM_BLOCK_SIZE);
 
-    while (num-- > 0) {
-        mmap_set(base_block++);
+    while (num-- > 0 && base_block < num_frames) {
+        buddy_reserve(base_block++);
     }
 }
 
@@ -127,144 +213,346 @@ void pmm_deinit_region(uintptr_t addr, uint32_t size) {
  * Note: of course, this address is page-aligned.
  */
 uintptr_t pmm_alloc_page() {
-    if (max_blocks - used_blocks <= 0) {
+    // Cached file pages nobody maps are the first to go
+    if (!free_frames && !page_cache_reclaim()) {
         printke("kernel is out of physical memory!");
         abort();
     }
 
-    uint32_t block = mmap_find_free();
+    uint32_t eflags = spin_lock_irqsave(&pmm_lock);
+    uint32_t block = buddy_alloc(0);
 
-    if (!block)  {
-        return 0;
+    if (block != PMM_NONE) {
+        frames[block].refcount = 1;
     }
 
-    mmap_set(block);
+    spin_unlock_irqrestore(&pmm_lock, eflags);
+
+    if (block == PMM_NONE) {
+        return 0;
+    }
 
     return (uintptr_t) (block*PMM_BLOCK_SIZE);
 }
 
 /* Returns the address of a 4 MiB area of physical memory, aligned to 4 MiB.
- *
- * Strategy:
- * Find an 8 MiB section of memory. In there, we are guaranteed to find an
- * address that is 4 MiB-aligned. Return that, mark 4 MiB as taken.
+ * Buddy blocks are aligned to their size, so this is a plain allocation of
+ * the largest order.
  */
-uintptr_t pmm_alloc_aligned_large_page() { // TODO: generalize
-    if (max_blocks - used_blocks < 2*1024) { // 4MiB
-        return 0;
-    }
-
-    uint32_t free_block = mmap_find_free_frame(2*1024);
+uintptr_t pmm_alloc_aligned_large_page() {
+    uint32_t eflags = spin_lock_irqsave(&pmm_lock);
+    uint32_t block = buddy_alloc(PMM_MAX_ORDER);
+    spin_unlock_irqrestore(&pmm_lock, eflags);
 
-    if (!free_block) {
+    if (block == PMM_NONE) {
         return 0;
     }
 
-    uint32_t aligned_block = ((free_block / 1024) + 1) * 1024;
-
-    for (int i = 0; i < 1024; i++) {
-        mmap_set(aligned_block + i);
-    }
-
-    return (uintptr_t)(aligned_block*PMM_BLOCK_SIZE);
+    return (uintptr_t) (block*PMM_BLOCK_SIZE);
 }
 
+/* Returns the address of `num` contiguous pages of physical memory, or zero if
+ * there are none. `num` can't exceed the size of the largest buddy block.
+ * The allocation is rounded up to a block, whose excess is given back.
+ */
 uintptr_t pmm_alloc_pages(uint32_t num) {
-    if (max_blocks-used_blocks < num) {
+    uint32_t order = order_for(num);
+
+    if (!num || order > PMM_MAX_ORDER) {
         return 0;
     }
 
-    uint32_t first_block = mmap_find_free_frame(num);
+    uint32_t eflags = spin_lock_irqsave(&pmm_lock);
+    uint32_t first_block = buddy_alloc(order);
 
-    if (!first_block) {
+    if (first_block == PMM_NONE) {
+        spin_unlock_irqrestore(&pmm_lock, eflags);
         return 0;
     }
 
+    free_range(first_block + num, (1 << order) - num);
+
     for (uint32_t i = 0; i < num; i++) {
-        mmap_set(first_block+i);
+        frames[first_block + i].refcount = 1;
     }
 
+    spin_unlock_irqrestore(&pmm_lock, eflags);
+
     return (uintptr_t) (first_block*PMM_BLOCK_SIZE);
 }
 
 void pmm_free_page(uintptr_t addr) {
+    uint32_t eflags = spin_lock_irqsave(&pmm_lock);
+    free_frame(addr/PMM_BLOCK_SIZE);
+    spin_unlock_irqrestore(&pmm_lock, eflags);
+}
+
+/* Adds a reference to an allocated page, so that it's only freed once every
+ * user has called `pmm_unref_page` on it.
+ */
+void pmm_ref_page(uintptr_t addr) {
     uint32_t block = addr/PMM_BLOCK_SIZE;
-    mmap_unset(block);
+
+    if (block < num_frames) {
+        uint32_t eflags = spin_lock_irqsave(&pmm_lock);
+        frames[block].refcount++;
+        spin_unlock_irqrestore(&pmm_lock, eflags);
+    }
 }
 
-void pmm_free_pages(uintptr_t addr, uint32_t num) {
-    uint32_t first_block = addr/PMM_BLOCK_SIZE;
+/* Drops a reference to a page, freeing it when it was the last one.
+ */
+void pmm_unref_page(uintptr_t addr) {
+    uint32_t block = addr/PMM_BLOCK_SIZE;
 
-    for (uint32_t i = 0; i < num; i++) {
-        mmap_unset(first_block+i);
+    if (block >= num_frames) {
+        return;
+    }
+
+    uint32_t eflags = spin_lock_irqsave(&pmm_lock);
+
+    if (frames[block].refcount <= 1) {
+        free_frame(block);
+    } else {
+        frames[block].refcount--;
     }
+
+    spin_unlock_irqrestore(&pmm_lock, eflags);
 }
 
-void mmap_set(uint32_t bit) {
-    bitmap[bit / 32] |= NTHBIT(bit % 32);
-    used_blocks++;
+uint32_t pmm_get_refcount(uintptr_t addr) {
+    uint32_t block = addr/PMM_BLOCK_SIZE;
+
+    return block < num_frames ? frames[block].refcount : 0;
 }
 
-void mmap_unset(uint32_t bit) {
-    bitmap[bit / 32] &= ~NTHBIT(bit % 32);
-    used_blocks--;
+/* Frees `num` pages starting at `addr`. Any page previously returned by the
+ * PMM can be freed independently of the allocation it was part of.
+ */
+void pmm_free_pages(uintptr_t addr, uint32_t num) {
+    uint32_t eflags = spin_lock_irqsave(&pmm_lock);
+    free_range(addr/PMM_BLOCK_SIZE, num);
+    spin_unlock_irqrestore(&pmm_lock, eflags);
 }
 
-uint32_t mmap_test(uint32_t bit) {
-    return bitmap[bit / 32] & NTHBIT(bit % 32);
+/* Returns the first address after the kernel and its data in physical memory.
+ */
+uintptr_t pmm_get_kernel_end() {
+    return frames_phys_end > kernel_end ? frames_phys_end : kernel_end;
 }
 
-/* Returns the index of the first free bit in the bitmap
+/* Returns a page-aligned physical address at which `size` bytes of available
+ * memory can hold the frame array, after the kernel and outside of the
+ * multiboot information. Returns zero if there's no such place.
  */
-uint32_t mmap_find_free() {
-    for (uint32_t i = 0; i < max_blocks/32; i++) {
-        if (bitmap[i] != 0xFFFFFFFF) {
-            for (uint32_t j = 0; j < 32; j++) {
-                if (!(bitmap[i] & NTHBIT(j))) {
-                    return i * 32 + j;
-                }
+static uintptr_t pmm_find_frames_location(mb2_t* boot, uint32_t size) {
+    mb2_tag_mmap_t* mmap = (mb2_tag_mmap_t*) mb2_find_tag(boot, MB2_TAG_MMAP);
+    mb2_mmap_entry_t* ent = mmap->entries;
+    uintptr_t boot_start = (uintptr_t) boot;
+    uintptr_t boot_end = boot_start + boot->total_size;
+
+    while ((uintptr_t) ent < (uintptr_t) mmap + mmap->header.size) {
+        if (ent->type == MB2_MMAP_AVAIL && ent->base_addr < 0x100000000) {
+            uint64_t end = ent->base_addr + ent->length;
+            uint64_t start = ent->base_addr > kernel_end ? ent->base_addr : kernel_end;
+
+            start = align_to(start, PMM_BLOCK_SIZE);
+
+            if (start < boot_end && start + size > boot_start) {
+                start = align_to(boot_end, PMM_BLOCK_SIZE);
+            }
+
+            if (end > 0x100000000) {
+                end = 0x100000000;
+            }
+
+            if (start + size <= end) {
+                return (uintptr_t) start;
             }
         }
+
+        ent = (mb2_mmap_entry_t*) ((uintptr_t) ent + mmap->entry_size);
     }
 
     return 0;
 }
 
-/* Returns the first block of frame_size bits
+/* Maps `size` bytes of physical memory at `phys` to `PMM_FRAMES_BEGIN`.
+ * This happens before paging is properly setup, so we write our page tables
+ * and the kernel directory directly.
  */
-uint32_t mmap_find_free_frame(uint32_t frame_size) {
-    uint32_t first = 0;
-    uint32_t count = 0;
-
-    for (uint32_t i = 0; i < max_blocks/32; i++) {
-        if (bitmap[i] != 0xFFFFFFFF) {
-            for (uint32_t j = 0; j < 32; j++) {
-                if (!(bitmap[i] & NTHBIT(j))) {
-                    if (!first) {
-                        first = i*32+j;
-                    }
-
-                    count++;
-                } else {
-                    first = 0;
-                    count = 0;
-                }
-
-                if (count == frame_size) {
-                    return first;
-                }
-            }
+static void pmm_map_frames(uintptr_t phys, uint32_t size) {
+    uint32_t num_pages = divide_up(size, PMM_BLOCK_SIZE);
+    uint32_t dir_index = PMM_FRAMES_BEGIN >> 22;
+
+    for (uint32_t i = 0; i < num_pages; i++) {
+        frame_tables[i / 1024][i % 1024] = (phys + i*PMM_BLOCK_SIZE) | PAGE_PRESENT | PAGE_RW;
+    }
+
+    for (uint32_t i = 0; i < divide_up(num_pages, 1024); i++) {
+        uintptr_t table_phys = VIRT_TO_PHYS((uintptr_t) frame_tables[i]);
+        kernel_directory[dir_index + i] = table_phys | PAGE_PRESENT | PAGE_RW;
+    }
+
+    paging_invalidate_cache();
+}
+
+static void list_push(uint32_t frame, uint32_t order) {
+    uint32_t head = free_lists[order];
+
+    frames[frame] = (pmm_frame_t) {
+        .next = head,
+        .prev = PMM_NONE,
+        .order = order,
+        .flags = PMM_FRAME_FREE
+    };
+
+    if (head != PMM_NONE) {
+        frames[head].prev = frame;
+    }
+
+    free_lists[order] = frame;
+}
+
+static void list_remove(uint32_t frame, uint32_t order) {
+    pmm_frame_t* f = &frames[frame];
+
+    if (f->prev != PMM_NONE) {
+        frames[f->prev].next = f->next;
+    } else {
+        free_lists[order] = f->next;
+    }
+
+    if (f->next != PMM_NONE) {
+        frames[f->next].prev = f->prev;
+    }
+
+    f->flags &= ~PMM_FRAME_FREE;
+}
+
+/* Returns the first frame of a free block of 2^order frames, splitting a larger
+ * block if needed. Returns `PMM_NONE` if there's no such block.
+ */
+static uint32_t buddy_alloc(uint32_t order) {
+    uint32_t o = order;
+
+    while (o <= PMM_MAX_ORDER && free_lists[o] == PMM_NONE) {
+        o++;
+    }
+
+    if (o > PMM_MAX_ORDER) {
+        return PMM_NONE;
+    }
+
+    uint32_t frame = free_lists[o];
+    list_remove(frame, o);
+
+    // Give back the upper halves we don't need
+    while (o > order) {
+        o--;
+        list_push(frame + (1 << o), o);
+    }
+
+    free_frames -= 1 << order;
+
+    return frame;
+}
+
+/* Returns a block of 2^order frames to its free list, merging it with its
+ * buddy for as long as that buddy is free too.
+ */
+static void buddy_free(uint32_t frame, uint32_t order) {
+    free_frames += 1 << order;
+
+    while (order < PMM_MAX_ORDER) {
+        uint32_t buddy = frame ^ (1 << order);
+
+        if (buddy >= num_frames || !(frames[buddy].flags & PMM_FRAME_FREE) ||
+                frames[buddy].order != order) {
+            break;
+        }
+
+        list_remove(buddy, order);
+        frame &= ~(1 << order);
+        order++;
+    }
+
+    list_push(frame, order);
+}
+
+/* Takes a specific frame out of the free block that contains it, if any,
+ * splitting that block around the frame.
+ */
+static void buddy_reserve(uint32_t frame) {
+    uint32_t order;
+    uint32_t head = frame;
+
+    for (order = 0; order <= PMM_MAX_ORDER; order++) {
+        head = frame & ~((1 << order) - 1);
+
+        if (frames[head].flags & PMM_FRAME_FREE && frames[head].order == order) {
+            break;
+        }
+    }
+
+    // Not part of any free block, it's already in use
+    if (order > PMM_MAX_ORDER) {
+        return;
+    }
+
+    list_remove(head, order);
+
+    while (order > 0) {
+        order--;
+        uint32_t half = 1 << order;
+
+        if (frame >= head + half) {
+            list_push(head, order);
+            head += half;
         } else {
-            first = 0;
-            count = 0;
+            list_push(head + half, order);
         }
     }
 
-    return 0;
+    free_frames--;
 }
 
-/* Returns the first address after the kernel in physical memory.
+/* Frees `num` frames starting at `frame` in blocks as large as their
+ * alignment allows.
  */
-uintptr_t pmm_get_kernel_end() {
-    return (uintptr_t) kernel_end + max_blocks / 8;
-}
\ No newline at end of file
+static void free_range(uint32_t frame, uint32_t num) {
+    while (num) {
+        uint32_t order = 0;
+
+        while (order < PMM_MAX_ORDER && !(frame & (1 << order)) && (2u << order) <= num) {
+            order++;
+        }
+
+        buddy_free(frame, order);
+        frame += 1 << order;
+        num -= 1 << order;
+    }
+}
+
+/* Returns the smallest order whose blocks hold at least `num` frames.
+ */
+static uint32_t order_for(uint32_t num) {
+    uint32_t order = 0;
+
+    while ((1u << order) < num) {
+        order++;
+    }
+
+    return order;
+}
+
+/* Frees a single frame, with `pmm_lock` held.
+ */
+static void free_frame(uint32_t block) {
+    if (block >= num_frames || frames[block].flags & PMM_FRAME_FREE) {
+        printke("invalid free of frame %p", block*PMM_BLOCK_SIZE);
+        return;
+    }
+
+    buddy_free(block, 0);
+}
@@ -0,0 +1,271 @@
+#include <kernel/irq.h>
+#include <kernel/paging.h>
+#include <kernel/pmm.h>
+#include <kernel/slab.h>
+#include <kernel/sys.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLAB_PAGES (KERNEL_SLAB_SIZE / 0x1000)
+#define SLAB_ALIGN 4
+
+/* A slab is a single page holding objects of a single cache, preceded by this
+ * header. Free objects are chained through their first word.
+ */
+typedef struct _slab_t {
+    kmem_cache_t* cache;
+    struct _slab_t* next;
+    struct _slab_t* prev;
+    void* free;
+    uint32_t used;
+} slab_t;
+
+/* Caches sort their slabs depending on how many objects are allocated in them.
+ * Allocations are served from partial slabs first, and at most one empty slab
+ * is kept around to absorb alloc/free churn.
+ */
+struct _kmem_cache_t {
+    char name[16];
+    uint32_t obj_size;
+    uint32_t objs_per_slab;
+    slab_t* partial;
+    slab_t* full;
+    slab_t* empty;
+    uint32_t num_slabs;
+    uint32_t active_objs;
+    struct _kmem_cache_t* next;
+};
+
+static void* slab_alloc_page();
+static void slab_free_page(void* page);
+static slab_t* slab_new(kmem_cache_t* cache);
+static void slab_push(slab_t** list, slab_t* slab);
+static void slab_remove(slab_t** list, slab_t* slab);
+
+// Caches themselves are allocated from this one
+static kmem_cache_t cache_cache = {
+    .name = "kmem_cache",
+    .obj_size = sizeof(kmem_cache_t),
+    .objs_per_slab = (0x1000 - sizeof(slab_t)) / sizeof(kmem_cache_t)
+};
+
+static kmem_cache_t* caches = &cache_cache;
+static uint32_t slab_pages[SLAB_PAGES / 32];
+
+/* Creates the page tables covering the slab area, while we're still running
+ * in the kernel's page directory: processes copy it, so pages mapped there
+ * later on will be shared by everyone.
+ */
+void init_slab() {
+    for (uintptr_t addr = KERNEL_SLAB_BEGIN; addr < KERNEL_SLAB_BEGIN + KERNEL_SLAB_SIZE; addr += 0x400000) {
+        paging_get_page(addr, true, PAGE_RW);
+    }
+}
+
+/* Creates a cache of objects of `size` bytes. `name` is only used for
+ * statistics.
+ */
+kmem_cache_t* kmem_cache_create(const char* name, uint32_t size) {
+    size = align_to(max(size, sizeof(void*)), SLAB_ALIGN);
+
+    if (size > 0x1000 - sizeof(slab_t)) {
+        printke("object size too large for cache %s: %d", name, size);
+        return NULL;
+    }
+
+    kmem_cache_t* cache = kmem_cache_alloc(&cache_cache);
+
+    if (!cache) {
+        return NULL;
+    }
+
+    *cache = (kmem_cache_t) {
+        .obj_size = size,
+        .objs_per_slab = (0x1000 - sizeof(slab_t)) / size,
+        .next = caches
+    };
+
+    strncpy(cache->name, name, sizeof(cache->name) - 1);
+    caches = cache;
+
+    return cache;
+}
+
+/* Returns an uninitialized object from the cache, or NULL if we're out of
+ * memory.
+ */
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+    // Interrupt handlers allocate objects too
+    uint32_t eflags = irq_save();
+    slab_t* slab = cache->partial;
+
+    if (!slab) {
+        if (cache->empty) {
+            slab = cache->empty;
+            cache->empty = NULL;
+        } else {
+            slab = slab_new(cache);
+
+            if (!slab) {
+                irq_restore(eflags);
+                return NULL;
+            }
+        }
+
+        slab_push(&cache->partial, slab);
+    }
+
+    void* obj = slab->free;
+    slab->free = *(void**) obj;
+    slab->used++;
+    cache->active_objs++;
+
+    if (slab->used == cache->objs_per_slab) {
+        slab_remove(&cache->partial, slab);
+        slab_push(&cache->full, slab);
+    }
+
+    irq_restore(eflags);
+
+    return obj;
+}
+
+/* Returns an object to its cache. The slab it belongs to is found from its
+ * address.
+ */
+void kmem_cache_free(kmem_cache_t* cache, void* obj) {
+    if (!obj) {
+        return;
+    }
+
+    slab_t* slab = (slab_t*) ((uintptr_t) obj & PAGE_FRAME);
+
+    if (slab->cache != cache) {
+        printke("object %p freed to the wrong cache: %s", obj, cache->name);
+        abort();
+    }
+
+    uint32_t eflags = irq_save();
+
+    if (slab->used == cache->objs_per_slab) {
+        slab_remove(&cache->full, slab);
+        slab_push(&cache->partial, slab);
+    }
+
+    *(void**) obj = slab->free;
+    slab->free = obj;
+    slab->used--;
+    cache->active_objs--;
+
+    if (slab->used == 0) {
+        slab_remove(&cache->partial, slab);
+
+        if (cache->empty) {
+            cache->num_slabs--;
+            slab_free_page(slab);
+        } else {
+            cache->empty = slab;
+        }
+    }
+
+    irq_restore(eflags);
+}
+
+/* Fills `info` with the statistics of at most `max_caches` caches, returns the
+ * number of caches written.
+ */
+uint32_t kmem_cache_get_info(sys_cache_info_t* info, uint32_t max_caches) {
+    uint32_t n = 0;
+
+    for (kmem_cache_t* c = caches; c && n < max_caches; c = c->next, n++) {
+        strcpy(info[n].name, c->name);
+        info[n].obj_size = c->obj_size;
+        info[n].active_objs = c->active_objs;
+        info[n].total_objs = c->num_slabs * c->objs_per_slab;
+        info[n].num_pages = c->num_slabs;
+    }
+
+    return n;
+}
+
+/* Allocates a new slab for the cache and threads its objects together.
+ */
+static slab_t* slab_new(kmem_cache_t* cache) {
+    slab_t* slab = slab_alloc_page();
+
+    if (!slab) {
+        return NULL;
+    }
+
+    *slab = (slab_t) {
+        .cache = cache,
+        .free = NULL
+    };
+
+    uint8_t* objs = (uint8_t*) slab + align_to(sizeof(slab_t), SLAB_ALIGN);
+
+    for (int32_t i = cache->objs_per_slab - 1; i >= 0; i--) {
+        void** obj = (void**) (objs + i*cache->obj_size);
+        *obj = slab->free;
+        slab->free = obj;
+    }
+
+    cache->num_slabs++;
+
+    return slab;
+}
+
+/* Maps a physical page in the slab area and returns its address.
+ */
+static void* slab_alloc_page() {
+    for (uint32_t i = 0; i < SLAB_PAGES / 32; i++) {
+        if (slab_pages[i] == 0xFFFFFFFF) {
+            continue;
+        }
+
+        uint32_t bit = __builtin_ctz(~slab_pages[i]);
+        uintptr_t virt = KERNEL_SLAB_BEGIN + (i*32 + bit)*0x1000;
+
+        slab_pages[i] |= 1 << bit;
+        paging_map_page(virt, pmm_alloc_page(), PAGE_RW);
+
+        return (void*) virt;
+    }
+
+    printke("out of slab space");
+
+    return NULL;
+}
+
+static void slab_free_page(void* page) {
+    uint32_t index = ((uintptr_t) page - KERNEL_SLAB_BEGIN) / 0x1000;
+
+    paging_unmap_page((uintptr_t) page);
+    slab_pages[index / 32] &= ~(1 << (index % 32));
+}
+
+static void slab_push(slab_t** list, slab_t* slab) {
+    slab->prev = NULL;
+    slab->next = *list;
+
+    if (*list) {
+        (*list)->prev = slab;
+    }
+
+    *list = slab;
+}
+
+static void slab_remove(slab_t** list, slab_t* slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        *list = slab->next;
+    }
+
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+}
@@ -1,5 +1,7 @@
 #include <kernel/ext2.h>
 #include <kernel/fs.h>
+#include <kernel/mutex.h>
+#include <kernel/proc.h>
 #include <kernel/sys.h>
 
 #include <string.h>
@@ -122,6 +124,7 @@ typedef struct ext2_fs_t {
     uint32_t block_size;
     uint32_t inode_size;
     uint32_t num_block_groups;
+    mutex_t lock; // See `lock_fs`
 } ext2_fs_t;
 
 #define INODE_FIFO 0x1000
@@ -184,6 +187,8 @@ static uint32_t get_or_create_inode_block(ext2_fs_t* fs, ext2_inode_t* in, uint3
 static uint32_t get_inode_block(ext2_fs_t* fs, ext2_inode_t* inode, uint32_t n);
 static uint32_t add_directory_entry(ext2_fs_t* fs, const char* name, uint32_t d_ino, uint32_t type);
 static list_t* directory_to_entries(ext2_fs_t* fs, uint32_t ino);
+static bool lock_fs(ext2_fs_t* fs);
+static void unlock_fs(ext2_fs_t* fs, bool locked);
 static void write_directory_entries(ext2_fs_t* fs, uint32_t ino, list_t* dir_entries);
 static dentry_t* make_directory_entry(const char* name, uint32_t ino, uint32_t type);
 static void free_directory_entries(list_t* entries);
@@ -197,6 +202,7 @@ fs_t* init_ext2(uint8_t* data, uint32_t len) {
     }
 
     e2fs->device = data;
+    e2fs->lock = MUTEX_INIT(e2fs->lock);
     e2fs->sb = parse_superblock(e2fs);
     e2fs->group_descriptors = parse_group_descriptors(e2fs);
 
@@ -225,13 +231,18 @@ fs_t* init_ext2(uint8_t* data, uint32_t len) {
  * `type` is one of the `DENT_*` constants.
  */
 uint32_t ext2_create(ext2_fs_t* fs, const char* name, uint32_t type, uint32_t parent_inode) {
-    return add_directory_entry(fs, name, parent_inode, type);
+    bool locked = lock_fs(fs);
+    uint32_t ino = add_directory_entry(fs, name, parent_inode, type);
+    unlock_fs(fs, locked);
+
+    return ino;
 }
 
 /* Deletes the directory entry referencing `ino` in `d_ino`, deleting the inode
  * if it is no longer referenced anywhere.
  */
 int32_t ext2_unlink(ext2_fs_t* fs, uint32_t d_ino, uint32_t ino) {
+    bool locked = lock_fs(fs);
     ext2_inode_t* in = get_inode(fs, ino);
 
     list_t* entries = directory_to_entries(fs, d_ino);
@@ -255,17 +266,21 @@ int32_t ext2_unlink(ext2_fs_t* fs, uint32_t d_ino, uint32_t ino) {
         update_inode(fs, ino, in);
     }
 
+    unlock_fs(fs, locked);
+
     return 0;
 }
 
 /* Move `ino` whose parent directory is `dir_ino`, to the directory `destdir_ino`.
  */
 int32_t ext2_rename(ext2_fs_t* fs, uint32_t dir_ino, uint32_t ino, uint32_t destdir_ino) {
+    bool locked = lock_fs(fs);
     list_t* entries = directory_to_entries(fs, dir_ino);
     list_t* iter;
     dentry_t* ent;
 
     if (!entries) {
+        unlock_fs(fs, locked);
         return -1;
     }
 
@@ -281,6 +296,7 @@ int32_t ext2_rename(ext2_fs_t* fs, uint32_t dir_ino, uint32_t ino, uint32_t dest
     if (iter == entries) {
         free_directory_entries(entries);
         kfree(entries);
+        unlock_fs(fs, locked);
 
         return -1;
     }
@@ -291,6 +307,7 @@ int32_t ext2_rename(ext2_fs_t* fs, uint32_t dir_ino, uint32_t ino, uint32_t dest
     if (!new_entries) {
         free_directory_entries(entries);
         kfree(entries);
+        unlock_fs(fs, locked);
 
         return -1;
     }
@@ -305,6 +322,7 @@ int32_t ext2_rename(ext2_fs_t* fs, uint32_t dir_ino, uint32_t ino, uint32_t dest
     kfree(entries);
     free_directory_entries(new_entries);
     kfree(new_entries);
+    unlock_fs(fs, locked);
 
     return 0;
 }
@@ -313,6 +331,7 @@ int32_t ext2_rename(ext2_fs_t* fs, uint32_t dir_ino, uint32_t ino, uint32_t dest
  * Returns the number of bytes written.
  */
 uint32_t ext2_append(ext2_fs_t* fs, uint32_t inode, uint8_t* data, uint32_t size) {
+    bool locked = lock_fs(fs);
     ext2_inode_t* in = get_inode(fs, inode);
     uint8_t* tmp = zalloc(fs->block_size);
 
@@ -334,6 +353,8 @@ uint32_t ext2_append(ext2_fs_t* fs, uint32_t inode, uint8_t* data, uint32_t size
             } else {
                 write_inode_block(fs, in, block, data + (block - start_block)*fs->block_size);
             }
+
+            cond_resched();
         }
 
         if (offset_end) {
@@ -346,6 +367,7 @@ uint32_t ext2_append(ext2_fs_t* fs, uint32_t inode, uint8_t* data, uint32_t size
     update_inode(fs, inode, in);
     kfree(tmp);
     kfree(in);
+    unlock_fs(fs, locked);
 
     return size;
 }
@@ -355,9 +377,11 @@ uint32_t ext2_append(ext2_fs_t* fs, uint32_t inode, uint8_t* data, uint32_t size
  * I had started similarly but had ended up with much worse code.
  */
 uint32_t ext2_read(ext2_fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t size) {
+    bool locked = lock_fs(fs);
     ext2_inode_t* in = get_inode(fs, inode);
 
     if (!in) {
+        unlock_fs(fs, locked);
         return 0;
     }
 
@@ -366,6 +390,7 @@ uint32_t ext2_read(ext2_fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* buf,
 
     if (!size || !fsize || offset >= fsize) {
         kfree(in);
+        unlock_fs(fs, locked);
         return 0;
     }
 
@@ -395,6 +420,8 @@ uint32_t ext2_read(ext2_fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* buf,
                 read_inode_block(fs, in, block_no,
                     buf + (block_no - start_block)*fs->block_size - start_offset);
             }
+
+            cond_resched();
         }
 
         if (end_offset) {
@@ -405,6 +432,7 @@ uint32_t ext2_read(ext2_fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* buf,
 
     kfree(in);
     kfree(tmp);
+    unlock_fs(fs, locked);
 
     return bytes_read;
 }
@@ -416,15 +444,20 @@ uint32_t ext2_read(ext2_fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* buf,
 sos_directory_entry_t* ext2_readdir(ext2_fs_t* fs, uint32_t inode, uint32_t offset) {
     ext2_directory_entry_t ent;
 
+    // The directory mustn't change between both reads
+    bool locked = lock_fs(fs);
+
     // Read the beginning of the struct to know its size, then read it in full
     uint32_t read = ext2_read(fs, inode, offset, (uint8_t*) &ent, sizeof(ext2_directory_entry_t));
 
     if (!read) {
+        unlock_fs(fs, locked);
         return NULL;
     }
 
     ext2_directory_entry_t* entry = kmalloc(ent.entry_size);
     read = ext2_read(fs, inode, offset, (uint8_t*) entry, ent.entry_size);
+    unlock_fs(fs, locked);
 
     if (!read) {
         kfree(entry);
@@ -436,6 +469,7 @@ sos_directory_entry_t* ext2_readdir(ext2_fs_t* fs, uint32_t inode, uint32_t offs
 }
 
 inode_t* ext2_get_fs_inode(ext2_fs_t* fs, uint32_t inode) {
+    bool locked = lock_fs(fs);
     ext2_inode_t* in = get_inode(fs, inode);
     inode_t* fs_in = NULL;
 
@@ -452,6 +486,7 @@ inode_t* ext2_get_fs_inode(ext2_fs_t* fs, uint32_t inode) {
         fs_in = (inode_t*) fi;
     } else {
         printke("unsupported inode type: %X", INODE_TYPE(in->type_perms));
+        unlock_fs(fs, locked);
         return NULL;
     }
 
@@ -461,6 +496,7 @@ inode_t* ext2_get_fs_inode(ext2_fs_t* fs, uint32_t inode) {
     fs_in->fs = (fs_t*) fs;
 
     kfree(in);
+    unlock_fs(fs, locked);
 
     return fs_in;
 }
@@ -473,9 +509,11 @@ int32_t ext2_close(ext2_fs_t* fs, uint32_t ino) {
 }
 
 int32_t ext2_stat(ext2_fs_t* fs, uint32_t ino, stat_t* stat) {
+    bool locked = lock_fs(fs);
     ext2_inode_t* in = get_inode(fs, ino);
 
     if (!in) {
+        unlock_fs(fs, locked);
         return -1;
     }
 
@@ -485,6 +523,9 @@ int32_t ext2_stat(ext2_fs_t* fs, uint32_t ino, stat_t* stat) {
     stat->st_nlink = in->hardlinks_count;
     stat->st_size = in->size_lower;
 
+    kfree(in);
+    unlock_fs(fs, locked);
+
     return 0;
 }
 
@@ -716,13 +757,15 @@ static void free_inode(ext2_fs_t* fs, uint32_t ino) {
     /* Free the blocks owned by the inode */
     ext2_inode_t* in = get_inode(fs, ino);
     uint32_t num_blocks = divide_up(in->size_lower, fs->block_size);
-    kfree(in);
 
     for (uint32_t iblock = 0; iblock < num_blocks; iblock++) {
         uint32_t rblock = get_inode_block(fs, in, iblock);
         free_block(fs, rblock);
+        cond_resched();
     }
 
+    kfree(in);
+
     /* Free the inode itself */
     uint8_t* bitmap = kmalloc(fs->block_size);
     uint32_t group_no = ino / fs->sb->inodes_per_group;
@@ -1073,3 +1116,24 @@ static void free_directory_entries(list_t* entries) {
         list_del(list_first(entries));
     }
 }
+
+/* Operations give up the CPU between blocks when their time is up, see
+ * `cond_resched`: they're serialized with a mutex so that others don't see
+ * them half done. A process may already hold it when it faults on a mapped
+ * file in the middle of one, see `page_cache.c`. Returns whether it was taken.
+ */
+static bool lock_fs(ext2_fs_t* fs) {
+    if (fs->lock.owner && fs->lock.owner == proc_get_current()) {
+        return false;
+    }
+
+    mutex_lock(&fs->lock);
+
+    return true;
+}
+
+static void unlock_fs(ext2_fs_t* fs, bool locked) {
+    if (locked) {
+        mutex_unlock(&fs->lock);
+    }
+}
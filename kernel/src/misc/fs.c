@@ -1,5 +1,8 @@
 #include <kernel/fs.h>
+#include <kernel/mutex.h>
+#include <kernel/page_cache.h>
 #include <kernel/proc.h>
+#include <kernel/slab.h>
 #include <kernel/sys.h>
 
 #include <stdlib.h>
@@ -21,8 +24,12 @@ uint32_t tnode_to_directory_entry(tnode_t* tn, sos_directory_entry_t* d_ent, uin
 void fs_build_tree_level(folder_inode_t* dir_ino, inode_t* parent);
 
 static tnode_t* root;
+static kmem_cache_t* tnode_cache;
+static mutex_t tree_lock; // See `fs_build_tree_level`
 
 void init_fs(fs_t* fs) {
+    tnode_cache = kmem_cache_create("tnode", sizeof(tnode_t));
+    tree_lock = MUTEX_INIT(tree_lock);
     fs_mount("/", fs);
 }
 
@@ -47,24 +54,33 @@ void delete_tnode(tnode_t* tn) {
 
     kfree(in);
     kfree(tn->name);
-    kfree(tn);
+    kmem_cache_free(tnode_cache, tn);
 }
 
-/* Builds one level of vfs nodes with the children of the given inode.
- * Do not call twice on the same inode, unless previous entries have been
- * cleared previously.
+/* Builds one level of vfs nodes with the children of the given inode, unless
+ * that's been done already: previous entries must have been cleared to build
+ * it again.
+ * This gives up the CPU between entries when our time is up, see
+ * `cond_resched`: others wanting the same level wait for it to be complete.
  */
 void fs_build_tree_level(folder_inode_t* inode, inode_t* parent) {
     sos_directory_entry_t* dent = NULL;
     uint32_t offset = 0;
 
+    mutex_lock(&tree_lock);
+
+    if (!inode->dirty) {
+        mutex_unlock(&tree_lock);
+        return;
+    }
+
     /* Add "." and ".." ourselves, don't trust the fs */
-    tnode_t* tn = kmalloc(sizeof(tnode_t));
+    tnode_t* tn = kmem_cache_alloc(tnode_cache);
     tn->inode = (inode_t*) inode;
     tn->name = strdup(".");
     list_add(&inode->subfolders, tn);
 
-    tn = kmalloc(sizeof(tnode_t));
+    tn = kmem_cache_alloc(tnode_cache);
     tn->inode = parent;
     tn->name = strdup("..");
     list_add(&inode->subfolders, tn);
@@ -74,16 +90,18 @@ void fs_build_tree_level(folder_inode_t* inode, inode_t* parent) {
         offset += dent->entry_size;
 
         if (strncmp(dent->name, ".", dent->name_len_low) && strncmp(dent->name, "..", dent->name_len_low)) {
-            tn = kmalloc(sizeof(tnode_t));
+            tn = kmem_cache_alloc(tnode_cache);
             tn->name = strndup(dent->name, dent->name_len_low);
             tn->inode = FS(inode)->get_fs_inode(FS(inode), dent->inode);
             list_add(dent->type == DENT_FILE ? &inode->subfiles : &inode->subfolders, tn);
         }
 
         kfree(dent);
+        cond_resched();
     }
 
     inode->dirty = false;
+    mutex_unlock(&tree_lock);
 }
 
 /* Returns an inode_t* from a path.
@@ -119,7 +137,7 @@ inode_t* fs_open(const char* path, uint32_t flags) {
                 flags & O_CREAT ? DENT_FILE : DENT_DIRECTORY,
                 inode->ino.inode_no);
 
-            tnode_t* new_tn = kmalloc(sizeof(tnode_t));
+            tnode_t* new_tn = kmem_cache_alloc(tnode_cache);
             new_tn->inode = FS(inode)->get_fs_inode(FS(inode), new_ino);
             new_tn->name = strdup(part);
             list_add(flags & O_CREAT ? &inode->subfiles : &inode->subfolders, new_tn);
@@ -170,7 +188,7 @@ inode_t* fs_open(const char* path, uint32_t flags) {
 void fs_mount(const char* mount_point, fs_t* fs) {
     /* Special case for the first filesystem mounted */
     if (!root && !strcmp(mount_point, "/")) {
-        root = kmalloc(sizeof(tnode_t));
+        root = kmem_cache_alloc(tnode_cache);
         root->inode = (inode_t*) fs->root;
         root->name = strdup("/");
         return;
@@ -199,7 +217,7 @@ void fs_mount(const char* mount_point, fs_t* fs) {
     while (!list_empty(&mnt_in->subfolders)) {
         tnode_t* tn = list_first_entry(&mnt_in->subfolders, tnode_t);
         kfree(tn->name);
-        kfree(tn);
+        kmem_cache_free(tnode_cache, tn);
         list_del(list_first(&mnt_in->subfolders));
     }
 
@@ -241,13 +259,15 @@ int32_t fs_unlink(const char* path) {
         return -1;
     }
 
+    page_cache_invalidate(FS(in), in->inode_no);
+
     /* Prune it from the tree */
     list_t* iter;
     tnode_t* tn;
     list_for_each(iter, tn, &d_in->subfiles) {
         if (tn->inode->inode_no == in->inode_no) {
             kfree(tn->name);
-            kfree(tn);
+            kmem_cache_free(tnode_cache, tn);
 
             if (--in->hardlinks == 0) {
                 kfree(in);
@@ -361,6 +381,10 @@ uint32_t fs_write(inode_t* in, uint8_t* buf, uint32_t size) {
     uint32_t written = FS(in)->append(FS(in), in->inode_no, buf, size);
     in->size += written;
 
+    if (written) {
+        page_cache_invalidate(FS(in), in->inode_no);
+    }
+
     return written;
 }
 
@@ -1,5 +1,6 @@
 #include <kernel/pipe.h>
 #include <kernel/sys.h>
+#include <kernel/wait_queue.h>
 
 #include <ringbuffer.h>
 #include <stdlib.h>
@@ -7,41 +8,153 @@
 
 #define PIPE_SIZE 2048
 
+/* The buffer shared by all the ends of a pipe. Readers wait for data, writers
+ * wait for space. Each side stops waiting once the other has no end left.
+ */
+typedef struct pipe_t {
+    ringbuffer_t* buf;
+    wait_queue_t readers;
+    wait_queue_t writers;
+    uint32_t num_readers; // Read ends, see `pipe_open_end`
+    uint32_t num_writers; // Write ends, see `pipe_new`
+} pipe_t;
+
+/* An end of a pipe. Each end is its own filesystem, holding a single file.
+ */
 typedef struct pipe_fs_t {
     fs_t fs;
-    ringbuffer_t* buf;
+    pipe_t* pipe;
+    uint32_t flags;
+    bool reader; // Which count the end is part of
 } pipe_fs_t;
 
-uint32_t pipe_read(pipe_fs_t* pipe, uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t size) {
+static inode_t* pipe_new_end(pipe_t* pipe, uint32_t flags, bool reader);
+
+/* Reads at most `size` bytes from the pipe, waiting for some to be written if
+ * it's empty, unless the end was opened with `O_NONBLOCK`. Returns zero once
+ * the pipe is empty with no write end left.
+ */
+uint32_t pipe_read(pipe_fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t size) {
     UNUSED(inode); // There's only one "file" in this fs, the pipe itself
     UNUSED(offset);
 
-    return ringbuffer_read(pipe->buf, size, buf);
+    pipe_t* pipe = fs->pipe;
+
+    if (!size) {
+        return 0;
+    }
+
+    if (!(fs->flags & O_NONBLOCK)) {
+        wait_queue_sleep_until(&pipe->readers,
+            ringbuffer_available(pipe->buf) || !pipe->num_writers);
+    }
+
+    uint32_t read = ringbuffer_read(pipe->buf, size, buf);
+
+    if (read) {
+        wait_queue_wake_all(&pipe->writers);
+    }
+
+    return read;
 }
 
-uint32_t pipe_append(pipe_fs_t* pipe, uint32_t inode, uint8_t* data, uint32_t size) {
+/* Writes `size` bytes to the pipe, waiting for readers to make room as needed.
+ * Ends opened with `O_NONBLOCK` write what fits instead. Data is never
+ * overwritten. Writing stops short once there's no read end left, as nothing
+ * would make room anymore.
+ */
+uint32_t pipe_append(pipe_fs_t* fs, uint32_t inode, uint8_t* data, uint32_t size) {
     UNUSED(inode);
 
-    return ringbuffer_write(pipe->buf, size, data);
+    pipe_t* pipe = fs->pipe;
+    uint32_t written = 0;
+
+    while (written < size && pipe->num_readers) {
+        uint32_t space = PIPE_SIZE - ringbuffer_available(pipe->buf);
+
+        if (!space) {
+            if (fs->flags & O_NONBLOCK || wait_queue_interrupted()) {
+                break;
+            }
+
+            wait_queue_sleep_until(&pipe->writers,
+                ringbuffer_available(pipe->buf) < PIPE_SIZE || !pipe->num_readers);
+            continue;
+        }
+
+        uint32_t n = size - written < space ? size - written : space;
+
+        written += ringbuffer_write(pipe->buf, n, data + written);
+        wait_queue_wake_all(&pipe->readers);
+    }
+
+    return written;
 }
 
 int32_t pipe_close(pipe_fs_t* fs, uint32_t ino) {
     UNUSED(ino);
 
-    ringbuffer_free(fs->buf);
+    pipe_t* pipe = fs->pipe;
+
+    if (fs->reader) {
+        pipe->num_readers--;
+    } else {
+        pipe->num_writers--;
+    }
+
+    if (!pipe->num_readers && !pipe->num_writers) {
+        ringbuffer_free(pipe->buf);
+        kfree(pipe);
+    } else {
+        // Let the other side notice if we were the last end on ours
+        wait_queue_wake_all(&pipe->readers);
+        wait_queue_wake_all(&pipe->writers);
+    }
+
     kfree(fs->fs.root);
     kfree(fs);
 
     return 0;
 }
 
+/* Creates a pipe and returns its first write end, which blocks.
+ */
 inode_t* pipe_new() {
+    pipe_t* pipe = kmalloc(sizeof(pipe_t));
+
+    *pipe = (pipe_t) {
+        .buf = ringbuffer_new(PIPE_SIZE),
+        .readers = WAIT_QUEUE_INIT(pipe->readers),
+        .writers = WAIT_QUEUE_INIT(pipe->writers),
+        .num_readers = 0,
+        .num_writers = 0
+    };
+
+    return pipe_new_end(pipe, 0, false);
+}
+
+/* Returns a new read end to the same pipe as `in`, with its own flags. Only
+ * `O_NONBLOCK` is supported.
+ */
+inode_t* pipe_open_end(inode_t* in, uint32_t flags) {
+    return pipe_new_end(((pipe_fs_t*) in->fs)->pipe, flags, true);
+}
+
+static inode_t* pipe_new_end(pipe_t* pipe, uint32_t flags, bool reader) {
     // TODO: have root inodes not necessarily be folders?
     inode_t* p = zalloc(sizeof(folder_inode_t));
     p->fs = zalloc(sizeof(pipe_fs_t));
 
     pipe_fs_t* fs = (pipe_fs_t*) p->fs;
-    fs->buf = ringbuffer_new(PIPE_SIZE);
+    fs->pipe = pipe;
+    fs->flags = flags & O_NONBLOCK;
+    fs->reader = reader;
+
+    if (reader) {
+        pipe->num_readers++;
+    } else {
+        pipe->num_writers++;
+    }
 
     p->fs->root = (folder_inode_t*) p;
     p->fs->read = (fs_read_t) pipe_read;
@@ -49,4 +162,4 @@ inode_t* pipe_new() {
     p->fs->close = (fs_close_t) pipe_close;
 
     return p;
-}
\ No newline at end of file
+}
@@ -1,13 +1,20 @@
 #include <kernel/wm.h>
+#include <kernel/slab.h>
 #include <kernel/sys.h>
 
 #include <stdlib.h>
 #include <list.h>
 
-/* Allocates the specified `rect_t` on the stack.
+static kmem_cache_t* rect_cache;
+
+/* Allocates the specified `rect_t` on the heap.
  */
 rect_t* rect_new(uint32_t t, uint32_t l, uint32_t b, uint32_t r) {
-    rect_t* rect = (rect_t*) kmalloc(sizeof(rect_t));
+    if (!rect_cache) {
+        rect_cache = kmem_cache_create("rect", sizeof(rect_t));
+    }
+
+    rect_t* rect = (rect_t*) kmem_cache_alloc(rect_cache);
 
     *rect = (rect_t) {
         .top = t, .left = l, .bottom = b, .right = r
@@ -41,6 +48,23 @@ bool rect_intersect(rect_t a, rect_t b) {
            a.top <= b.bottom && a.bottom >= b.top;
 }
 
+/* Returns the smallest rectangle containing both `a` and `b`.
+ */
+rect_t rect_bounding_box(rect_t a, rect_t b) {
+    return (rect_t) {
+        .top = a.top < b.top ? a.top : b.top,
+        .left = a.left < b.left ? a.left : b.left,
+        .bottom = a.bottom > b.bottom ? a.bottom : b.bottom,
+        .right = a.right > b.right ? a.right : b.right
+    };
+}
+
+/* Returns the number of pixels in a rectangle, which must not be empty.
+ */
+uint32_t rect_area(rect_t r) {
+    return (r.bottom - r.top + 1)*(r.right - r.left + 1);
+}
+
 /* Pretty-prints a `rect_t`.
  */
 void print_rect(rect_t* r) {
@@ -63,7 +87,7 @@ void rect_subtract_clip_rect(list_t* rects, rect_t clip) {
 
             // Remove the newly-split rect from our clipping rects
             list_del(iter);
-            kfree(current);
+            kmem_cache_free(rect_cache, current);
 
             // Add in what remains of it after splitting
             list_splice(splits, rects);
@@ -86,7 +110,7 @@ void rect_add_clip_rect(list_t* rects, rect_t clip) {
  */
 void rect_clear_clipped(list_t* rects) {
     while (!list_empty(rects)) {
-        kfree(list_first_entry(rects, rect_t));
+        kmem_cache_free(rect_cache, list_first_entry(rects, rect_t));
         list_del(list_first(rects));
     }
 }
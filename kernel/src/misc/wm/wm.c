@@ -1,7 +1,13 @@
 #include <kernel/wm.h>
 #include <kernel/mouse.h>
 #include <kernel/kbd.h>
+#include <kernel/clock.h>
+#include <kernel/paging.h>
+#include <kernel/proc.h>
+#include <kernel/smp.h>
+#include <kernel/spinlock.h>
 #include <kernel/sys.h>
+#include <kernel/timer.h>
 
 #include <kernel/fs.h>
 
@@ -11,7 +17,11 @@
 #include <stdlib.h>
 
 #define MOUSE_SIZE 16
+#define MOUSE_SENS_NUM 7 // Sensitivity, as a fraction
+#define MOUSE_SENS_DEN 10
 #define WM_EVENT_QUEUE_SIZE 5
+#define WM_MAX_DAMAGE 16
+#define WM_COMPOSITE_ROWS 32 // Drawn per critical section, see `wm_composite`
 
 void wm_draw_window(wm_window_t* win, rect_t rect);
 void wm_partial_draw_window(wm_window_t* win, rect_t rect);
@@ -22,10 +32,19 @@ void wm_assign_z_orders();
 void wm_raise_window(wm_window_t* win);
 void wm_print_windows();
 list_t* wm_get_windows_above(wm_window_t* win);
+list_t* wm_get_window(uint32_t id);
+bool wm_is_titlebar_being_hovered(wm_window_t* win);
 rect_t wm_mouse_to_rect(mouse_t mouse);
 void wm_draw_mouse(rect_t new);
+int32_t wm_scale_mouse(int32_t delta, int32_t* remainder);
 void wm_mouse_callback(mouse_t curr);
 void wm_kbd_callback(kbd_event_t event);
+void wm_handle_mouse(mouse_t curr);
+void wm_handle_kbd(kbd_event_t event);
+void wm_push_event(wm_window_t* win, wm_event_t* event);
+void wm_damage(rect_t rect);
+void wm_composite();
+void wm_compositor();
 
 /* Windows are ordered by z-index in this list, e.g. the foremost window is in
  * the last position.
@@ -36,21 +55,88 @@ static uint32_t id_count = 0;
 static fb_t fb;
 static mouse_t mouse;
 
-void init_wm() {
+/* Held while using the WM, by system calls, by input handlers, which run as
+ * deferred work, see `work.c`, and by the compositor for a few rows at a
+ * time, see `wm_composite`. Holders mustn't sleep.
+ */
+static spinlock_t wm_lock = SPINLOCK_INIT;
+
+/* Parts of the screen to redraw on the next frame, see `wm_damage`. The
+ * compositor waits on `compositor_queue` while there are none.
+ */
+static rect_t damage[WM_MAX_DAMAGE];
+static uint32_t num_damage = 0;
+static wait_queue_t compositor_queue;
+static uint64_t frame_ns; // Time between frames
+static uint64_t next_frame = 0; // When the next frame may be composited
+static sys_wm_info_t stats;
+
+/* Starts the window manager. Passing "wm_fps=N" on the kernel command line
+ * sets the maximum frame rate. The compositor only wakes up on timer ticks,
+ * so it's capped to the timer's frequency.
+ */
+void init_wm(const char* cmdline) {
+    const char* fps_arg = cmdline ? strstr(cmdline, "wm_fps=") : NULL;
+    uint32_t fps = fps_arg ? atoi(fps_arg + strlen("wm_fps=")) : TIMER_FREQ;
+
     fb = fb_get_info();
     windows = LIST_HEAD_INIT(windows);
+    compositor_queue = WAIT_QUEUE_INIT(compositor_queue);
+
+    if (fps > TIMER_FREQ) {
+        printk("wm: frame rate capped to %d fps", TIMER_FREQ);
+    }
+
+    if (!fps || fps > TIMER_FREQ) {
+        fps = TIMER_FREQ;
+    }
+
+    frame_ns = 1000000000 / fps;
 
     mouse.x = fb.width/2;
     mouse.y = fb.height/2;
 
     mouse_set_callback(wm_mouse_callback);
     kbd_set_callback(wm_kbd_callback);
+
+    proc_run_kernel_thread(wm_compositor);
 }
 
-/* Associates a buffer with a window id. The calling program will then be able
- * to use this id to render the buffer through the window manager.
+/* Creates a window whose dimensions are described by `buff`, and allocates
+ * its buffer, which the calling program draws to directly: it's mapped in
+ * its address space as well as in the kernel's, and its address is written
+ * to `buff`. The program then uses the returned id to have the buffer drawn
+ * to the screen. Returns zero on failure.
  */
 uint32_t wm_open_window(fb_t* buff, uint32_t flags) {
+    // Windows are copied to the screen as they are, row by row, and must fit
+    // on it, see `wm_assign_position`
+    if (!buff->width || buff->width > fb.width ||
+            !buff->height || buff->height > fb.height ||
+            buff->bpp != fb.bpp || buff->pitch < buff->width*buff->bpp/8 ||
+            buff->pitch > fb.pitch) {
+        printke("open: invalid %dx%d window", buff->width, buff->height);
+        return 0;
+    }
+
+    uint32_t num_pages = divide_up(buff->height*buff->pitch, 0x1000);
+    void* surface = paging_alloc_shared(num_pages);
+    uintptr_t address = surface ? proc_map_shared(surface, num_pages) : 0;
+
+    if (!address) {
+        printke("open: no room for a %dx%d window", buff->width, buff->height);
+
+        if (surface) {
+            paging_free_shared(surface, num_pages);
+        }
+
+        return 0;
+    }
+
+    buff->address = address;
+
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+
     wm_window_t* win = (wm_window_t*) kmalloc(sizeof(wm_window_t));
 
     *win = (wm_window_t) {
@@ -58,50 +144,79 @@ uint32_t wm_open_window(fb_t* buff, uint32_t flags) {
         .kfb = *buff,
         .id = ++id_count,
         .flags = flags | WM_NOT_DRAWN,
-        .events = ringbuffer_new(WM_EVENT_QUEUE_SIZE * sizeof(wm_event_t))
+        .events = ringbuffer_new(WM_EVENT_QUEUE_SIZE * sizeof(wm_event_t)),
+        .waiters = WAIT_QUEUE_INIT(win->waiters),
+        .owner = proc_get_current()->leader->pid
     };
 
-    win->kfb.address = (uintptr_t) kmalloc(buff->height*buff->pitch);
+    win->kfb.address = (uintptr_t) surface;
 
     list_add_front(&windows, win);
     wm_assign_position(win);
     wm_assign_z_orders();
     wm_raise_window(win);
 
-    return win->id;
+    uint32_t id = win->id;
+    spin_unlock_irqrestore(&wm_lock, eflags);
+
+    return id;
 }
 
 void wm_close_window(uint32_t win_id) {
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+
     list_t* item = wm_get_window(win_id);
 
     if (item) {
         wm_window_t* win = list_entry(item, wm_window_t);
         rect_t rect = rect_from_window(win);
 
+        uint32_t num_pages = divide_up(win->kfb.height*win->kfb.pitch, 0x1000);
+
+        // The pages are freed once the owner, which may have exited, unmaps
+        // them too
+        if (proc_get_current()->leader->pid == win->owner) {
+            proc_unmap_shared(win->ufb.address);
+        }
+
         list_del(item);
+        wait_queue_wake_all(&win->waiters);
         ringbuffer_free(win->events);
-        kfree((void*) win->kfb.address);
-        kfree((void*) win);
+        paging_free_shared((void*) win->kfb.address, num_pages);
+
+        // Waiters still have to leave the queue, the last one frees it
+        if (win->num_waiters) {
+            win->closed = true;
+        } else {
+            kfree((void*) win);
+        }
 
         if (!list_empty(&windows)) {
             wm_raise_window(list_last_entry(&windows, wm_window_t));
         }
 
-        wm_refresh_partial(rect);
+        wm_damage(rect);
     } else {
         printke("close: failed to find window of id %d", win_id);
     }
+
+    spin_unlock_irqrestore(&wm_lock, eflags);
 }
 
-/* System call interface to draw a window. `clip` specifies which part to copy
- * from userspace and redraw. If `clip` is NULL, the whole window is redrawn.
+/* System call interface to draw a window. `clip` specifies which part of
+ * its buffer changed, and is redrawn on the next frame. If `clip` is NULL,
+ * the whole window is redrawn. Nothing is copied: the compositor reads the
+ * buffer directly.
  */
 void wm_render_window(uint32_t win_id, rect_t* clip) {
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+
     list_t* item = wm_get_window(win_id);
     rect_t rect;
 
     if (!item) {
         printke("render called by invalid window, id %d", win_id);
+        spin_unlock_irqrestore(&wm_lock, eflags);
         return;
     }
 
@@ -115,30 +230,29 @@ void wm_render_window(uint32_t win_id, rect_t* clip) {
         };
     }
 
-    // Copy the window's buffer in the kernel
-    uintptr_t off = clip->top*win->ufb.pitch + clip->left*win->ufb.bpp/8;
-    uint32_t len = (clip->right - clip->left + 1)*win->ufb.bpp/8;
-
-    for (int32_t i = clip->top; i <= clip->bottom; i++) {
-        memcpy((void*) (win->kfb.address + off), (void*) (win->ufb.address + off), len);
-        off += win->ufb.pitch;
-    }
-
-    // Draw the window for real
-    rect = rect_from_window(win);
-    wm_draw_window(win, *clip);
+    // Have it drawn on the next frame
+    rect = (rect_t) {
+        .top = win->pos.y + clip->top, .left = win->pos.x + clip->left,
+        .bottom = win->pos.y + clip->bottom, .right = win->pos.x + clip->right
+    };
+    wm_damage(rect);
 
     // Mark as drawn once
     if (win->flags & WM_NOT_DRAWN) {
         win->flags &= ~WM_NOT_DRAWN;
     }
+
+    spin_unlock_irqrestore(&wm_lock, eflags);
 }
 
 void wm_get_event(uint32_t win_id, wm_event_t* event) {
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+
     list_t* item = wm_get_window(win_id);
 
     if (!item) {
         printke("Get_event: invalid window %d", win_id);
+        spin_unlock_irqrestore(&wm_lock, eflags);
         return;
     }
 
@@ -149,6 +263,57 @@ void wm_get_event(uint32_t win_id, wm_event_t* event) {
     } else {
         memset(event, 0, sizeof(wm_event_t));
     }
+
+    spin_unlock_irqrestore(&wm_lock, eflags);
+}
+
+/* Like `wm_get_event`, but if no event is pending, blocks the calling process
+ * until one comes or `timeout` milliseconds have passed, if not zero.
+ * The window may be closed meanwhile: `event` is zeroed then.
+ */
+void wm_wait_event(uint32_t win_id, wm_event_t* event, uint32_t timeout) {
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+
+    list_t* item = wm_get_window(win_id);
+
+    if (!item) {
+        printke("Wait_event: invalid window %d", win_id);
+        spin_unlock_irqrestore(&wm_lock, eflags);
+        return;
+    }
+
+    wm_window_t* win = list_entry(item, wm_window_t);
+
+    // Events come from input handlers, which can't run between the check and
+    // going to sleep: the kernel isn't preemptible
+    if (!ringbuffer_available(win->events)) {
+        win->num_waiters++;
+        spin_unlock_irqrestore(&wm_lock, eflags);
+        wait_queue_sleep(&win->waiters, timeout);
+        eflags = spin_lock_irqsave(&wm_lock);
+
+        win->num_waiters--;
+
+        if (win->closed) {
+            if (!win->num_waiters) {
+                kfree(win);
+            }
+
+            memset(event, 0, sizeof(wm_event_t));
+            spin_unlock_irqrestore(&wm_lock, eflags);
+            return;
+        }
+    }
+
+    spin_unlock_irqrestore(&wm_lock, eflags);
+    wm_get_event(win_id, event);
+}
+
+/* Queues an event for a window and wakes up whoever's waiting for one.
+ */
+void wm_push_event(wm_window_t* win, wm_event_t* event) {
+    ringbuffer_write(win->events, sizeof(wm_event_t), (uint8_t*) event);
+    wait_queue_wake_all(&win->waiters);
 }
 
 /* Window management stuff */
@@ -174,7 +339,7 @@ void wm_raise_window(wm_window_t* win) {
     if (!focused) {
         focused = win;
         event.type = WM_EVENT_GAINED_FOCUS;
-        ringbuffer_write(win->events, sizeof(wm_event_t), (uint8_t*)&event);
+        wm_push_event(win, &event);
         return;
     }
 
@@ -185,10 +350,10 @@ void wm_raise_window(wm_window_t* win) {
 
     // Change focus only then
     event.type = WM_EVENT_LOST_FOCUS;
-    ringbuffer_write(focused->events, sizeof(wm_event_t), (uint8_t*)&event);
+    wm_push_event(focused, &event);
 
     event.type = WM_EVENT_GAINED_FOCUS;
-    ringbuffer_write(win->events, sizeof(wm_event_t), (uint8_t*)&event);
+    wm_push_event(win, &event);
     focused = win;
 
     list_t* topmost;
@@ -206,7 +371,7 @@ void wm_raise_window(wm_window_t* win) {
 
     // Redraw if possible. Not sure this is this function's responsibility.
     if (!(win->flags & WM_NOT_DRAWN)) {
-        wm_draw_window(win, rect_from_window(win));
+        wm_damage(rect_from_window(win));
     }
 }
 
@@ -221,11 +386,12 @@ void wm_assign_position(wm_window_t* win) {
         return;
     }
 
+    // Windows are no larger than the screen, see `wm_open_window`
     int max_x = fb.width - win->ufb.width;
     int max_y = fb.height - win->ufb.height;
 
-    win->pos.x = rand() % max_x;
-    win->pos.y = rand() % max_y;
+    win->pos.x = rand() % (max_x + 1);
+    win->pos.y = rand() % (max_y + 1);
 }
 
 /* Makes sure that z-level related flags are respected.
@@ -286,6 +452,8 @@ void wm_partial_draw_window(wm_window_t* win, rect_t clip) {
         memcpy((void*) fb_off, (void*) (win_off + (y - win->pos.y)*wfb->pitch), len);
         fb_off += fb.pitch;
     }
+
+    stats.pixels += (clip.bottom - clip.top + 1)*(clip.right - clip.left + 1);
 }
 
 /* Draws the visible parts of the window that are within the given clipping
@@ -316,10 +484,6 @@ void wm_draw_window(wm_window_t* win, rect_t rect) {
         }
     }
 
-    // Redraw the mouse
-    rect_t mouse_rect = wm_mouse_to_rect(mouse);
-    wm_draw_mouse(mouse_rect);
-
     rect_clear_clipped(&clip_rects);
 }
 
@@ -350,19 +514,201 @@ void wm_refresh_partial(rect_t clip) {
             memset((void*) off, 0, size);
             off += fb.pitch;
         }
+
+        stats.pixels += (r->bottom - r->top + 1)*(r->right - r->left + 1);
     }
 
     rect_clear_clipped(&to_refresh);
 }
 
-/* Redraws every visible area of the screen.
+/* Redraws every visible area of the screen on the next frame.
  */
 void wm_refresh_screen() {
     rect_t screen_rect = {
-        .top = 0, .left = 0, .bottom = fb.height, .right = fb.width
+        .top = 0, .left = 0, .bottom = fb.height - 1, .right = fb.width - 1
     };
 
-    wm_refresh_partial(screen_rect);
+    wm_damage(screen_rect);
+}
+
+/* Marks a part of the screen as needing to be redrawn on the next frame.
+ * Overlapping damage is merged into its bounding box: drawing a little more
+ * is cheaper than walking the windows once more for each piece.
+ */
+void wm_damage(rect_t rect) {
+    rect.top = rect.top < 0 ? 0 : rect.top;
+    rect.left = rect.left < 0 ? 0 : rect.left;
+    rect.bottom = rect.bottom >= (int32_t) fb.height ? (int32_t) fb.height - 1 : rect.bottom;
+    rect.right = rect.right >= (int32_t) fb.width ? (int32_t) fb.width - 1 : rect.right;
+
+    if (rect.top > rect.bottom || rect.left > rect.right) {
+        return;
+    }
+
+    if (!num_damage) {
+        wait_queue_wake_one(&compositor_queue);
+    }
+
+    // A merged rect may overlap rects it didn't before, so start over
+    bool merged = true;
+
+    while (merged) {
+        merged = false;
+
+        for (uint32_t i = 0; i < num_damage; i++) {
+            if (rect_intersect(rect, damage[i])) {
+                rect = rect_bounding_box(rect, damage[i]);
+                damage[i] = damage[--num_damage];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    // Out of room: merge with whichever rect grows the least
+    if (num_damage == WM_MAX_DAMAGE) {
+        uint32_t best = 0;
+        uint32_t best_growth = UINT32_MAX;
+
+        for (uint32_t i = 0; i < num_damage; i++) {
+            rect_t merged = rect_bounding_box(rect, damage[i]);
+            uint32_t growth = rect_area(merged) - rect_area(damage[i]);
+
+            if (growth < best_growth) {
+                best = i;
+                best_growth = growth;
+            }
+        }
+
+        rect = rect_bounding_box(rect, damage[best]);
+        damage[best] = damage[--num_damage];
+        wm_damage(rect);
+
+        return;
+    }
+
+    damage[num_damage++] = rect;
+}
+
+/* Redraws the damaged parts of the screen, and the cursor over them, in the
+ * back buffer, then copies them to the screen in one go, see `fb.c`.
+ * The damage is taken as it is, then drawn `WM_COMPOSITE_ROWS` at a time
+ * with the lock held, so that interrupts aren't held off for a whole frame.
+ * Windows may change in between: whatever they damage then is redrawn on the
+ * next frame. Only the compositor uses the back buffer and the screen.
+ */
+void wm_composite() {
+    uint64_t start = clock_get_ns();
+    rect_t rects[WM_MAX_DAMAGE];
+
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+    uint32_t num_rects = num_damage;
+    rect_t mouse_rect = wm_mouse_to_rect(mouse);
+    bool mouse_damaged = false;
+
+    memcpy(rects, damage, num_rects*sizeof(rect_t));
+    num_damage = 0;
+    spin_unlock_irqrestore(&wm_lock, eflags);
+
+    for (uint32_t i = 0; i < num_rects; i++) {
+        rect_t band = rects[i];
+
+        for (int32_t top = rects[i].top; top <= rects[i].bottom; top += WM_COMPOSITE_ROWS) {
+            band.top = top;
+            band.bottom = top + WM_COMPOSITE_ROWS - 1;
+            band.bottom = band.bottom > rects[i].bottom ? rects[i].bottom : band.bottom;
+
+            eflags = spin_lock_irqsave(&wm_lock);
+            smp_sync_tlb(); // Closed windows' buffers may have been unmapped
+            wm_refresh_partial(band);
+            spin_unlock_irqrestore(&wm_lock, eflags);
+        }
+
+        mouse_damaged |= rect_intersect(rects[i], mouse_rect);
+    }
+
+    if (mouse_damaged) {
+        wm_draw_mouse(mouse_rect);
+    }
+
+    for (uint32_t i = 0; i < num_rects; i++) {
+        fb_flush(&rects[i]);
+    }
+
+    // The cursor may stick out of the damage
+    if (mouse_damaged) {
+        fb_flush(&mouse_rect);
+    }
+
+    eflags = spin_lock_irqsave(&wm_lock);
+    stats.frames++;
+    stats.time_ns += clock_get_ns() - start;
+    spin_unlock_irqrestore(&wm_lock, eflags);
+}
+
+/* Composites a frame whenever the screen is damaged, at most once every
+ * `frame_ns`. Damage that comes in the meantime, from any number of render
+ * calls or mouse movements, is drawn all at once.
+ * Frames are due at fixed deadlines, so that waking up on timer ticks doesn't
+ * change the frame rate on average.
+ * Runs as a kernel thread.
+ */
+void wm_compositor() {
+    STI(); // Kernel threads start with interrupts disabled
+
+    while (true) {
+        wait_queue_sleep_until(&compositor_queue, num_damage);
+
+        uint64_t now;
+
+        // Sleeps are counted in ticks, which may not line up with the deadline
+        while ((now = clock_get_ns()) < next_frame) {
+            uint32_t ticks = divide_up(next_frame - now, 1000000000 / TIMER_FREQ);
+            proc_sleep(ticks*1000/TIMER_FREQ);
+        }
+
+        // Don't make up for frames that weren't needed
+        if (now - next_frame > frame_ns) {
+            next_frame = now;
+        }
+
+        next_frame += frame_ns;
+
+        // Compositing only touches the WM, the framebuffer and the heap: other
+        // CPUs may run kernel code meanwhile
+        uint32_t depth = kernel_drop_lock();
+        wm_composite();
+        kernel_relock(depth);
+    }
+}
+
+/* Copies the compositor's statistics to `info`.
+ */
+void wm_get_info(sys_wm_info_t* info) {
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+    *info = stats;
+    spin_unlock_irqrestore(&wm_lock, eflags);
+}
+
+/* Returns whether the cursor is over the title bar of the window `win_id`.
+ * TODO: replace by a combination of cursor events and their handling in the
+ * titlebar widget.
+ */
+bool wm_is_hovered(uint32_t win_id) {
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+
+    list_t* item = wm_get_window(win_id);
+    bool hovered = false;
+
+    if (item) {
+        hovered = wm_is_titlebar_being_hovered(list_entry(item, wm_window_t));
+    } else {
+        printke("the given window id (%d) is unknown", win_id);
+    }
+
+    spin_unlock_irqrestore(&wm_lock, eflags);
+
+    return hovered;
 }
 
 /* Other helpers */
@@ -476,25 +822,36 @@ void wm_draw_mouse(rect_t new) {
     }
 }
 
+/* Scales raw mouse movement by the sensitivity. What's lost to rounding is
+ * carried over to the next movement.
+ */
+int32_t wm_scale_mouse(int32_t delta, int32_t* remainder) {
+    int32_t scaled = delta*MOUSE_SENS_NUM + *remainder;
+
+    *remainder = scaled % MOUSE_SENS_DEN;
+
+    return scaled / MOUSE_SENS_DEN;
+}
+
 /* Handles mouse events. This includes moving the cursor, moving windows along
  * with it, and distributing clicks.
  */
-void wm_mouse_callback(mouse_t raw_curr) {
+void wm_handle_mouse(mouse_t raw_curr) {
     static mouse_t raw_prev;
     static wm_window_t* previously_hovered_win = NULL;
     static wm_window_t* clicked_win = NULL;
     static bool win_dragged = false;
     static point_t initial_position;
-    static float cumulative_dx, cumulative_dy;
+    static int32_t cumulative_dx, cumulative_dy;
+    static int32_t remainder_x, remainder_y;
 
     const mouse_t prev = mouse;
-    const float sens = 0.7f;
     const int32_t max_x = fb.width - MOUSE_SIZE - 1;
     const int32_t max_y = fb.height - MOUSE_SIZE - 1;
 
     // Move the cursor
-    float dx = (raw_curr.x - raw_prev.x)*sens;
-    float dy = (raw_curr.y - raw_prev.y)*sens;
+    int32_t dx = wm_scale_mouse(raw_curr.x - raw_prev.x, &remainder_x);
+    int32_t dy = wm_scale_mouse(raw_curr.y - raw_prev.y, &remainder_y);
 
     mouse.x += dx;
     mouse.y += dy;
@@ -528,7 +885,7 @@ void wm_mouse_callback(mouse_t raw_curr) {
             event.mouse.position.top -= r.top;
             event.mouse.position.left -= r.left;
 
-            ringbuffer_write(clicked_win->events, sizeof(wm_event_t), (uint8_t*) &event);
+            wm_push_event(clicked_win, &event);
         }
     }
 
@@ -544,13 +901,8 @@ void wm_mouse_callback(mouse_t raw_curr) {
             clicked_win->pos.x = initial_position.x + cumulative_dx;
             clicked_win->pos.y = initial_position.y + cumulative_dy;
 
-            rect_t new_rect = rect_from_window(clicked_win);
-
-            wm_refresh_partial(rect);
-            wm_draw_window(clicked_win, new_rect);
-
-            rect = wm_mouse_to_rect(mouse);
-            wm_draw_mouse(rect);
+            wm_damage(rect);
+            wm_damage(rect_from_window(clicked_win));
         }
     }
 
@@ -565,7 +917,7 @@ void wm_mouse_callback(mouse_t raw_curr) {
             event.mouse.position.top -= r.top;
             event.mouse.position.left -= r.left;
 
-            ringbuffer_write(clicked_win->events, sizeof(wm_event_t), (uint8_t*) &event);
+            wm_push_event(clicked_win, &event);
         }
 
         clicked_win = NULL;
@@ -587,13 +939,13 @@ void wm_mouse_callback(mouse_t raw_curr) {
             if (previously_hovered_win) {
                 event.type = WM_EVENT_MOUSE_EXIT;
 
-                ringbuffer_write(previously_hovered_win->events, sizeof(wm_event_t), (uint8_t*) &event);
+                wm_push_event(previously_hovered_win, &event);
             }
 
             if (under_cursor) {
                 event.type = WM_EVENT_MOUSE_ENTER;
 
-                ringbuffer_write(under_cursor->events, sizeof(wm_event_t), (uint8_t*) &event);
+                wm_push_event(under_cursor, &event);
             }
 
             previously_hovered_win = under_cursor;
@@ -602,21 +954,21 @@ void wm_mouse_callback(mouse_t raw_curr) {
         if (under_cursor) {
             event.type = WM_EVENT_MOUSE_MOVE;
 
-            ringbuffer_write(under_cursor->events, sizeof(wm_event_t), (uint8_t*) &event);
+            wm_push_event(under_cursor, &event);
         }
 
         rect_t prev_pos = wm_mouse_to_rect(prev);
         rect_t curr_pos = wm_mouse_to_rect(mouse);
 
-        wm_refresh_partial(prev_pos);
-        wm_draw_mouse(curr_pos);
+        wm_damage(prev_pos);
+        wm_damage(curr_pos);
     }
 
     // Update the saved cursor state
     raw_prev = raw_curr;
 }
 
-void wm_kbd_callback(kbd_event_t event) {
+void wm_handle_kbd(kbd_event_t event) {
     wm_event_t kbd_event;
 
     if (!list_empty(&windows)) {
@@ -628,7 +980,7 @@ void wm_kbd_callback(kbd_event_t event) {
             kbd_event.kbd.keycode = event.keycode;
             kbd_event.kbd.pressed = event.pressed;
             kbd_event.kbd.repr = event.repr;
-            ringbuffer_write(win->events, sizeof(wm_event_t), (uint8_t*) &kbd_event);
+            wm_push_event(win, &kbd_event);
 
             if (!(win->flags & WM_SKIP_INPUT)) {
                 return;
@@ -636,3 +988,18 @@ void wm_kbd_callback(kbd_event_t event) {
         }
     }
 }
+
+/* Input handlers, run by the kernel worker after the interrupt handlers
+ * queued the input, see `mouse.c` and `kbd.c`.
+ */
+void wm_mouse_callback(mouse_t curr) {
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+    wm_handle_mouse(curr);
+    spin_unlock_irqrestore(&wm_lock, eflags);
+}
+
+void wm_kbd_callback(kbd_event_t event) {
+    uint32_t eflags = spin_lock_irqsave(&wm_lock);
+    wm_handle_kbd(event);
+    spin_unlock_irqrestore(&wm_lock, eflags);
+}
@@ -0,0 +1,141 @@
+#include <kernel/futex.h>
+#include <kernel/paging.h>
+#include <kernel/proc.h>
+#include <kernel/slab.h>
+#include <kernel/spinlock.h>
+#include <kernel/wait_queue.h>
+
+#include <stdlib.h>
+
+#define FUTEX_BUCKETS 64
+
+/* Futexes let threads wait for a value in memory to change without spinning,
+ * so that userspace locks only enter the kernel when they're contended.
+ * A futex is the wait queue of the threads of a process waiting on one
+ * address. It's created by the first waiter and freed with the last one.
+ * Futexes are kept in buckets by address, each with a lock that covers their
+ * futexes and wait queues.
+ */
+typedef struct {
+    process_t* leader;
+    uintptr_t addr;
+    wait_queue_t queue;
+    uint32_t waiters;
+} futex_t;
+
+static list_t buckets[FUTEX_BUCKETS];
+static spinlock_t bucket_locks[FUTEX_BUCKETS];
+static kmem_cache_t* futex_cache;
+
+static uint32_t futex_bucket(uintptr_t addr);
+static list_t* futex_find(uintptr_t addr, bool create);
+
+void init_futex() {
+    futex_cache = kmem_cache_create("futex", sizeof(futex_t));
+
+    for (uint32_t i = 0; i < FUTEX_BUCKETS; i++) {
+        buckets[i] = LIST_HEAD_INIT(buckets[i]);
+        bucket_locks[i] = SPINLOCK_INIT;
+    }
+}
+
+/* Blocks the current thread until `futex_wake` is called on `addr`, provided
+ * that `*addr` still holds `expected`, or for at most `timeout` milliseconds
+ * if it isn't zero. Returns 0 if woken up, -1 otherwise.
+ * The bucket's lock is held from checking the value until we're queued, so
+ * that a thread on another CPU can't change it and wake the futex up in
+ * between.
+ */
+int32_t futex_wait(uint32_t* addr, uint32_t expected, uint32_t timeout) {
+    if ((uintptr_t) addr >= KERNEL_BASE_VIRT || (uintptr_t) addr % 4) {
+        return -1;
+    }
+
+    // Also faults the page in, if needed, before taking the lock
+    if (*(volatile uint32_t*) addr != expected) {
+        return -1;
+    }
+
+    spinlock_t* lock = &bucket_locks[futex_bucket((uintptr_t) addr)];
+    uint32_t eflags = spin_lock_irqsave(lock);
+
+    if (*(volatile uint32_t*) addr != expected) {
+        spin_unlock_irqrestore(lock, eflags);
+        return -1;
+    }
+
+    list_t* item = futex_find((uintptr_t) addr, true);
+    futex_t* futex = list_entry(item, futex_t);
+
+    futex->waiters++;
+    bool woken = wait_queue_sleep_locked(&futex->queue, lock, timeout);
+
+    if (--futex->waiters == 0) {
+        list_del(item);
+        kmem_cache_free(futex_cache, futex);
+    }
+
+    spin_unlock_irqrestore(lock, eflags);
+
+    return woken ? 0 : -1;
+}
+
+/* Wakes up to `count` threads waiting on `addr`, returns how many were.
+ */
+uint32_t futex_wake(uint32_t* addr, uint32_t count) {
+    spinlock_t* lock = &bucket_locks[futex_bucket((uintptr_t) addr)];
+    uint32_t eflags = spin_lock_irqsave(lock);
+    list_t* item = futex_find((uintptr_t) addr, false);
+    uint32_t woken = 0;
+
+    if (item) {
+        futex_t* futex = list_entry(item, futex_t);
+
+        while (woken < count && !list_empty(&futex->queue.waiters)) {
+            wait_queue_wake_one(&futex->queue);
+            woken++;
+        }
+    }
+
+    spin_unlock_irqrestore(lock, eflags);
+
+    return woken;
+}
+
+static uint32_t futex_bucket(uintptr_t addr) {
+    return (addr >> 2) % FUTEX_BUCKETS;
+}
+
+/* Returns the list item holding the current process's futex at `addr`, after
+ * creating it if asked to. Returns NULL otherwise if it doesn't exist.
+ * The bucket's lock must be held.
+ */
+static list_t* futex_find(uintptr_t addr, bool create) {
+    process_t* leader = proc_get_current()->leader;
+    list_t* bucket = &buckets[futex_bucket(addr)];
+    list_t* iter;
+    futex_t* futex;
+
+    list_for_each(iter, futex, bucket) {
+        if (futex->leader == leader && futex->addr == addr) {
+            return iter;
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    futex = kmem_cache_alloc(futex_cache);
+
+    *futex = (futex_t) {
+        .leader = leader,
+        .addr = addr,
+        .queue = WAIT_QUEUE_INIT(futex->queue),
+        .waiters = 0
+    };
+
+    list_add(bucket, futex);
+
+    return bucket->prev;
+}
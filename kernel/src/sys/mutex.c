@@ -0,0 +1,49 @@
+#include <kernel/mutex.h>
+#include <kernel/irq.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+
+/* Mutexes protect data across long sections of kernel code, which run with
+ * interrupts enabled. Interrupt handlers can't sleep: they may only use
+ * `mutex_trylock`, and leave what they had to do to the owner otherwise.
+ */
+
+void mutex_lock(mutex_t* mutex) {
+    uint32_t eflags = irq_save();
+
+    while (mutex->owner) {
+        wait_queue_sleep(&mutex->waiters, 0);
+    }
+
+    mutex->owner = proc_get_current();
+    irq_restore(eflags);
+}
+
+/* Takes the mutex if it's free, returns whether it was.
+ */
+bool mutex_trylock(mutex_t* mutex) {
+    uint32_t eflags = irq_save();
+    bool free = !mutex->owner;
+
+    if (free) {
+        mutex->owner = proc_get_current();
+    }
+
+    irq_restore(eflags);
+
+    return free;
+}
+
+void mutex_unlock(mutex_t* mutex) {
+    uint32_t eflags = irq_save();
+
+    if (mutex->owner != proc_get_current()) {
+        printke("mutex released by a process that doesn't hold it");
+        abort();
+    }
+
+    mutex->owner = NULL;
+    wait_queue_wake_one(&mutex->waiters);
+    irq_restore(eflags);
+}
@@ -1,13 +1,19 @@
 #include <kernel/proc.h>
+#include <kernel/clock.h>
 #include <kernel/timer.h>
 #include <kernel/paging.h>
 #include <kernel/pmm.h>
+#include <kernel/elf.h>
 #include <kernel/gdt.h>
+#include <kernel/page_cache.h>
 #include <kernel/fpu.h>
 #include <kernel/fs.h>
 #include <kernel/pipe.h>
+#include <kernel/slab.h>
+#include <kernel/smp.h>
 #include <kernel/sys.h>
 
+#include <kernel/sched_mlfq.h>
 #include <kernel/sched_robin.h>
 
 #include <stdio.h>
@@ -16,24 +22,62 @@
 
 extern uint32_t irq_handler_end;
 
-process_t* current_process = NULL;
-sched_t* scheduler = NULL;
+// Each CPU runs its own processes, see `smp.h`
+#define current_process (cpu_get_current()->current)
+// What threads share lives in their leader, see `proc_thread_create`
+#define current_leader (current_process->leader)
 
 static uint32_t next_pid = 1;
+static kmem_cache_t* ft_entry_cache;
+
+// The kernel stack of the last process to exit, which couldn't free it itself
+static void* dead_kernel_stack = NULL;
+// Likewise for the last thread of the last process to end, see `proc_exit`
+static process_t* dead_process = NULL;
+
+static proc_region_t* proc_add_region(process_t* process, uintptr_t start, uintptr_t end);
+static void proc_copy_on_write(uintptr_t page, uint32_t flags);
+static elf_phdr_t* proc_read_elf(inode_t* in, elf_header_t* header);
+static registers_t* proc_setup_kernel_stack(process_t* process, registers_t* regs);
+static list_t* proc_find_thread(uint32_t tid);
+static void proc_release_address_space();
+static cpu_t* proc_least_loaded_cpu();
+static void proc_add_to_cpu(process_t* process, cpu_t* cpu);
+static process_t* proc_new_kernel_process(uint32_t cpu, uint32_t pid, void (*entry)());
+static void proc_idle();
+
+/* Gives each CPU a scheduler and an idle process, which runs whenever the
+ * scheduler has nothing to run.
+ * Passing "sched=robin" on the kernel command line selects the round robin
+ * scheduler instead of the default one.
+ */
+void init_proc(const char* cmdline) {
+    ft_entry_cache = kmem_cache_create("ft_entry", sizeof(ft_entry_t));
+
+    for (uint32_t i = 0; i < num_cpus; i++) {
+        if (cmdline && strstr(cmdline, "sched=robin")) {
+            cpus[i].scheduler = sched_robin();
+        } else {
+            cpus[i].scheduler = sched_mlfq();
+        }
 
-void init_proc() {
-    scheduler = sched_robin();
+        cpus[i].idle = proc_new_kernel_process(i, 0, proc_idle);
+    }
 }
 
-/* Creates a process running the code specified at `code` in raw instructions
- * and add it to the process queue, after the currently executing process.
+/* Creates a process running the ELF executable `in` and add it to the process
+ * queue, after the currently executing process. Returns NULL if the file
+ * isn't a valid executable.
+ * The file isn't read here: each loadable segment becomes a region whose
+ * pages are mapped from the page cache as they're accessed.
  * `argv` is the array of arguments, NULL terminated.
  */
-process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv) {
-    static uintptr_t temp_page = 0;
+process_t* proc_run_image(inode_t* in, char** argv) {
+    elf_header_t header;
+    elf_phdr_t* phdrs = proc_read_elf(in, &header);
 
-    if (!temp_page) {
-        temp_page = (uintptr_t) kamalloc(0x1000, 0x1000);
+    if (!phdrs) {
+        return NULL;
     }
 
     // Save arguments before switching directory and losing them
@@ -44,19 +88,22 @@ process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv) {
         argv++;
     }
 
-    // TODO: this assumes .bss sections are marked as progbits
-    uint32_t num_code_pages = divide_up(size, 0x1000);
     uint32_t num_stack_pages = PROC_STACK_PAGES;
 
-    process_t* process = kmalloc(sizeof(process_t));
+    // Only the top of the stack holding the arguments is mapped right away
+    uint32_t args_size = 2*sizeof(uint32_t);
+    char* arg;
+    list_for_each_entry(arg, &args) {
+        args_size += align_to(strlen(arg) + 1, 4) + sizeof(char*);
+    }
+
+    process_t* process = aligned_alloc(16, sizeof(process_t));
     uintptr_t kernel_stack = (uintptr_t) aligned_alloc(4, 0x1000 * PROC_KERNEL_STACK_PAGES);
     uintptr_t pd_phys = pmm_alloc_page();
 
     // Copy the kernel page directory with a temporary mapping
-    page_t* p = paging_get_page(temp_page, false, 0);
-    *p = pd_phys | PAGE_PRESENT | PAGE_RW;
-    memcpy((void*) temp_page, (void*) 0xFFFFF000, 0x1000);
-    directory_entry_t* pd = (directory_entry_t*) temp_page;
+    directory_entry_t* pd = paging_map_temp(pd_phys);
+    memcpy(pd, (void*) 0xFFFFF000, 0x1000);
     pd[1023] = pd_phys | PAGE_PRESENT | PAGE_RW;
 
     // ">> 22" grabs the address's index in the page directory, see `paging.c`
@@ -68,25 +115,18 @@ process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv) {
     uintptr_t previous_pd = *paging_get_page(0xFFFFF000, false, 0) & PAGE_FRAME;
     paging_switch_directory(pd_phys);
 
-    // Map the code and copy it to physical pages, zero out the excess memory
-    // for static variables
-    // TODO: don't require contiguous pages
-    uintptr_t code_phys = pmm_alloc_pages(num_code_pages);
-    paging_map_pages(0x00001000, code_phys, num_code_pages, PAGE_USER | PAGE_RW);
-    memcpy((void*) 0x00001000, (void*) code, size);
-    memset((uint8_t*) 0x1000 + size, 0, num_code_pages * 0x1000 - size);
+    for (uint32_t i = 1; i <= divide_up(args_size, 0x1000); i++) {
+        paging_map_page(0xC0000000 - 0x1000*i, pmm_alloc_page(), PAGE_USER | PAGE_RW);
+    }
 
-    // Map the stack
-    uintptr_t stack_phys = pmm_alloc_pages(num_stack_pages);
-    paging_map_pages(0xC0000000 - 0x1000 * num_stack_pages, stack_phys,
-        num_stack_pages, PAGE_USER | PAGE_RW);
+    // Shared with every process, read-only, and not part of any region
+    paging_map_page(CLOCK_PAGE_ADDR, clock_ref_page(), PAGE_USER);
 
     /* Setup the (argc, argv) part of the userstack, start by copying the given
      * arguments on that stack. */
     list_t arglist = LIST_HEAD_INIT(arglist);
     char* ustack_char = (char*) (0xC0000000 - 1);
 
-    char* arg;
     list_for_each_entry(arg, &args) {
         uint32_t len = strlen(arg);
 
@@ -121,7 +161,7 @@ process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv) {
 
     *process = (process_t) {
         .pid = next_pid++,
-        .code_len = num_code_pages,
+        .code_len = 0,
         .stack_len = num_stack_pages,
         .directory = pd_phys,
         .kernel_stack = kernel_stack + PROC_KERNEL_STACK_PAGES * 0x1000 - 4,
@@ -130,9 +170,48 @@ process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv) {
         .mem_len = 0,
         .sleep_ticks = 0,
         .filetable = LIST_HEAD_INIT(process->filetable),
-        .cwd = strdup("/")
+        .cwd = strdup("/"),
+        .regions = LIST_HEAD_INIT(process->regions),
+        .entry = header.entry,
+        .leader = process,
+        .threads = LIST_HEAD_INIT(process->threads),
+        .num_threads = 1,
+        .join_queue = WAIT_QUEUE_INIT(process->join_queue)
     };
 
+    fpu_init_process(process);
+
+    // Only writable segments are mapped writable, and they're private: their
+    // pages are copied from the cache when first written to. Whatever lies
+    // past the file-backed part of a segment, i.e. .bss, is zeroed.
+    uintptr_t heap_start = 0;
+
+    for (uint32_t i = 0; i < header.phnum; i++) {
+        elf_phdr_t* ph = &phdrs[i];
+
+        if (ph->type != ELF_PT_LOAD || !ph->memsz) {
+            continue;
+        }
+
+        uintptr_t start = ph->vaddr & PAGE_FRAME;
+        uintptr_t end = align_to(ph->vaddr + ph->memsz, 0x1000);
+        proc_region_t* segment = proc_add_region(process, start, end);
+
+        segment->flags = PAGE_USER | (ph->flags & ELF_PF_W ? PAGE_RW : 0);
+        segment->fs = in->fs;
+        segment->inode_no = in->inode_no;
+        segment->file_offset = ph->offset & PAGE_FRAME;
+        segment->file_size = ph->filesz ? (ph->offset & ~PAGE_FRAME) + ph->filesz : 0;
+
+        process->code_len += (end - start) / 0x1000;
+        heap_start = end > heap_start ? end : heap_start;
+    }
+
+    kfree(phdrs);
+
+    process->heap = proc_add_region(process, heap_start, heap_start);
+    proc_add_region(process, 0xC0000000 - 0x1000*num_stack_pages, 0xC0000000);
+
     // We use this label as the return address from `proc_switch_process`
     uint32_t* jmp = &irq_handler_end;
 
@@ -151,7 +230,7 @@ process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv) {
         "push %%eax\n"         // %esp
         "push $0x202\n"        // %eflags with `IF` bit set
         "push $0x1B\n"         // user cs selector
-        "push $0x00001000\n"   // %eip
+        "push %[entry]\n"      // %eip
         // Push error code, interrupt number
         "sub $8, %%esp\n"
         // `pusha` equivalent
@@ -181,70 +260,294 @@ process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv) {
         : [esp] "=r" (process->saved_kernel_stack)
         : [kstack] "r" (process->kernel_stack),
           [ustack] "r" (process->initial_user_stack),
+          [entry] "r" (process->entry),
           [jmp] "r" (jmp)
         : "%eax", "%ebx"
     );
 
-    scheduler->sched_add(scheduler, process);
+    proc_add_to_cpu(process, proc_least_loaded_cpu());
 
     return process;
 }
 
-/* Runs the scheduler. The scheduler may then decide to elect a new process, or
- * not.
+/* Creates a copy of the current process, whose userspace state is saved in
+ * `regs`, and adds it to the process queue. The child returns 0 from the
+ * system call.
+ * User pages aren't copied: both processes share them read-only until one of
+ * them writes to a page, see `proc_handle_fault`.
+ */
+process_t* proc_fork(registers_t* regs) {
+    process_t* process = aligned_alloc(16, sizeof(process_t));
+    uintptr_t kernel_stack = (uintptr_t) aligned_alloc(4, 0x1000 * PROC_KERNEL_STACK_PAGES);
+    uintptr_t pd_phys = pmm_alloc_page();
+
+    // The kernel part of the directory is shared, as in `proc_run_image`
+    directory_entry_t* pd = paging_map_temp(pd_phys);
+    memcpy(pd, (void*) 0xFFFFF000, 0x1000);
+    pd[1023] = pd_phys | PAGE_PRESENT | PAGE_RW;
+
+    // Give the child its own copy of each page table, with every page
+    // write-protected in both processes
+    directory_entry_t* current_pd = (directory_entry_t*) 0xFFFFF000;
+
+    for (uint32_t i = 0; i < (KERNEL_BASE_VIRT >> 22); i++) {
+        if (!(current_pd[i] & PAGE_PRESENT)) {
+            continue;
+        }
+
+        page_t* table = (page_t*) (0xFFC00000 + (i << 12));
+        uintptr_t table_phys = pmm_alloc_page();
+
+        for (uint32_t j = 0; j < 1024; j++) {
+            if (table[j] & PAGE_PRESENT) {
+                if (!(table[j] & PAGE_SHARED)) {
+                    table[j] &= ~PAGE_RW;
+                }
+
+                pmm_ref_page(table[j] & PAGE_FRAME);
+            }
+        }
+
+        memcpy(paging_map_temp(table_phys), table, 0x1000);
+        pd = paging_map_temp(pd_phys);
+        pd[i] = table_phys | (current_pd[i] & PAGE_FLAGS);
+    }
+
+    paging_invalidate_cache();
+    smp_flush_user_tlbs();
+
+    *process = (process_t) {
+        .pid = next_pid++,
+        .code_len = current_leader->code_len,
+        .stack_len = current_leader->stack_len,
+        .directory = pd_phys,
+        .kernel_stack = kernel_stack + PROC_KERNEL_STACK_PAGES * 0x1000 - 4,
+        .mem_len = current_leader->mem_len,
+        .sleep_ticks = 0,
+        .filetable = LIST_HEAD_INIT(process->filetable),
+        .cwd = strdup(current_leader->cwd),
+        .regions = LIST_HEAD_INIT(process->regions),
+        .entry = current_leader->entry,
+        .leader = process,
+        .threads = LIST_HEAD_INIT(process->threads),
+        .num_threads = 1,
+        .join_queue = WAIT_QUEUE_INIT(process->join_queue)
+    };
+
+    fpu_fork(process);
+
+    proc_region_t* region;
+    list_for_each_entry(region, &current_leader->regions) {
+        proc_region_t* copy = kmalloc(sizeof(proc_region_t));
+        *copy = *region;
+        list_add(&process->regions, copy);
+
+        if (region == current_leader->heap) {
+            process->heap = copy;
+        }
+    }
+
+    ft_entry_t* ent;
+    list_for_each_entry(ent, &current_leader->filetable) {
+        ent->refcount++;
+        list_add_front(&process->filetable, ent);
+    }
+
+    // The child returns from the same system call
+    registers_t* child_regs = proc_setup_kernel_stack(process, regs);
+    child_regs->eax = 0;
+
+    proc_add_to_cpu(process, proc_least_loaded_cpu());
+
+    return process;
+}
+
+/* Creates a thread of the current process starting at `entry` in userspace
+ * with `stack` as its stack pointer, and adds it to the process queue.
+ * Threads share everything but their stacks and registers, and run on any
+ * CPU: user mappings they change are flushed from other CPUs' TLBs, see
+ * `smp_flush_user_tlbs`.
+ */
+process_t* proc_thread_create(registers_t* regs, uintptr_t entry, uintptr_t stack) {
+    process_t* leader = current_leader;
+    process_t* thread = aligned_alloc(16, sizeof(process_t));
+    uintptr_t kernel_stack = (uintptr_t) aligned_alloc(4, 0x1000 * PROC_KERNEL_STACK_PAGES);
+
+    *thread = (process_t) {
+        .pid = next_pid++,
+        .directory = leader->directory,
+        .kernel_stack = kernel_stack + PROC_KERNEL_STACK_PAGES * 0x1000 - 4,
+        .sleep_ticks = 0,
+        .filetable = LIST_HEAD_INIT(thread->filetable),
+        .regions = LIST_HEAD_INIT(thread->regions),
+        .leader = leader,
+        .threads = LIST_HEAD_INIT(thread->threads),
+        .join_queue = WAIT_QUEUE_INIT(thread->join_queue)
+    };
+
+    fpu_init_process(thread);
+
+    registers_t* thread_regs = proc_setup_kernel_stack(thread, regs);
+    thread_regs->eip = entry;
+    thread_regs->esp = stack;
+    thread_regs->ebp = 0;
+    thread->initial_user_stack = stack;
+
+    list_add(&leader->threads, thread);
+    leader->num_threads++;
+
+    proc_add_to_cpu(thread, proc_least_loaded_cpu());
+
+    return thread;
+}
+
+/* Waits for the thread `tid` of the current process to exit, and frees what's
+ * left of it after storing the value it exited with in `value`. Returns -1 if
+ * there's no such thread.
+ */
+int32_t proc_thread_join(uint32_t tid, uint32_t* value) {
+    list_t* iter = proc_find_thread(tid);
+
+    if (!iter || list_entry(iter, process_t) == current_process) {
+        return -1;
+    }
+
+    while (!list_entry(iter, process_t)->exited) {
+        if (wait_queue_interrupted()) {
+            return -1;
+        }
+
+        wait_queue_sleep(&list_entry(iter, process_t)->join_queue, 0);
+
+        // Another thread may have joined it in the meantime
+        if (!(iter = proc_find_thread(tid))) {
+            return -1;
+        }
+    }
+
+    if (value) {
+        *value = list_entry(iter, process_t)->exit_value;
+    }
+
+    kfree(list_entry(iter, process_t));
+    list_del(iter);
+
+    return 0;
+}
+
+/* Runs the scheduler of the current CPU. The scheduler may then decide to
+ * elect a new process, or not.
  */
 void proc_schedule() {
-    process_t* next = scheduler->sched_next(scheduler);
+    uint32_t eflags = irq_save();
+    cpu_t* cpu = cpu_get_current();
+    process_t* prev = cpu->current;
+    process_t* next = cpu->scheduler->sched_next(cpu->scheduler);
 
-    if (next == current_process) {
+    cpu->need_resched = false;
+
+    if (!next) {
+        next = cpu->idle;
+    }
+
+    if (next == prev) {
+        irq_restore(eflags);
         return;
     }
 
-    fpu_switch(current_process, next);
-    proc_switch_process(next);
+    // The timer stops ticking when idle, see `proc_idle`
+    if (prev == cpu->idle) {
+        timer_set_periodic();
+    }
+
+    cpu->current = next;
+    gdt_set_kernel_stack(next->kernel_stack);
+    fpu_switch(prev, next);
+
+    // The CPU keeps holding the big kernel lock, but `next` may expect to
+    // hold it a different number of times: new processes expect it once,
+    // others restore their count
+    uint32_t lock_depth = cpu->lock_depth;
+    cpu->lock_depth = 1;
+    proc_switch_process(prev, next);
+    cpu->lock_depth = lock_depth;
+    irq_restore(eflags);
 }
 
 /* Called on clock ticks, calls the scheduler.
  */
 void proc_timer_callback(registers_t* regs) {
-    UNUSED(regs);
+    proc_preempt(regs);
+}
+
+/* Runs the scheduler from an interrupt handler, `regs` being the state of the
+ * interrupted code. System calls run with interrupts enabled so that handlers
+ * aren't delayed by long ones, but the kernel isn't preemptible: they give up
+ * the CPU on their way out, see `syscall_handler`, or when long ones call
+ * `cond_resched`.
+ */
+void proc_preempt(registers_t* regs) {
+    cpu_t* cpu = cpu_get_current();
+
+    if (!(regs->cs & 3) && cpu->current != cpu->idle) {
+        cpu->need_resched = true;
+        return;
+    }
 
     proc_schedule();
+
+    if (regs->cs & 3) {
+        proc_check_exit();
+    }
 }
 
-/* Make the first jump to usermode.
- * A special function is needed as our first kernel stack isn't setup to return
- * to any interrupt handler; we have to `iret` ourselves.
+/* Gives up the CPU if the current process's time is up, see `proc_preempt`.
+ * Called between steps of long operations, where what they work on is
+ * consistent or protected by a mutex. Does nothing with interrupts disabled,
+ * as a spinlock may be held then.
+ */
+void cond_resched() {
+    uint32_t eflags = irq_save();
+
+    if (eflags & EFLAGS_IF && cpu_get_current()->need_resched) {
+        proc_schedule();
+    }
+
+    irq_restore(eflags);
+}
+
+/* Starts a kernel thread running `entry` on the bootstrap processor, which
+ * handles interrupts. It starts with interrupts disabled, holding the big
+ * kernel lock once, and must never return.
+ * Kernel code isn't preempted: the thread only gives up the CPU when it
+ * sleeps or calls `proc_schedule`.
+ */
+process_t* proc_run_kernel_thread(void (*entry)()) {
+    process_t* process = proc_new_kernel_process(0, next_pid++, entry);
+
+    proc_add_to_cpu(process, &cpus[0]);
+
+    return process;
+}
+
+/* Starts running processes on the current CPU, which must hold the big
+ * kernel lock. This doesn't return: we switch to the idle process, which
+ * switches to the first process to run, whose kernel stack is setup to
+ * return to usermode, see `proc_run_image`.
  */
 void proc_enter_usermode() {
-    CLI(); // Interrupts will be reenabled by `iret`
+    cpu_t* cpu = cpu_get_current();
 
-    current_process = scheduler->sched_get_current(scheduler);
+    CLI(); // Interrupts will be reenabled by `iret`, or when idling
 
-    if (!current_process) {
-        printke("no process to run");
-        abort();
+    // Other CPUs' ticks only run their scheduler, see `smp.c`
+    if (cpu->id == 0) {
+        timer_register_callback(&proc_timer_callback);
     }
 
-    timer_register_callback(&proc_timer_callback);
-    gdt_set_kernel_stack(current_process->kernel_stack);
-    paging_switch_directory(current_process->directory);
-
-    asm volatile (
-        "mov $0x23, %%eax\n"
-        "mov %%eax, %%ds\n"
-        "mov %%eax, %%es\n"
-        "mov %%eax, %%fs\n"
-        "mov %%eax, %%gs\n"
-        "push %%eax\n"       // %ss
-        "mov %[ustack], %%eax\n"
-        "push %%eax\n"       // %esp
-        "push $0x202\n"      // %eflags with IF set
-        "push $0x1B\n"       // %cs
-        "push $0x00001000\n" // %eip
-        "iret\n"
-        :: [ustack] "r" (current_process->initial_user_stack)
-        : "%eax");
+    cpu->current = cpu->idle;
+    gdt_set_kernel_stack(cpu->idle->kernel_stack);
+    proc_switch_process(NULL, cpu->idle);
 }
 
 /* Returns the filetable entry associated with fd, if any.
@@ -252,7 +555,7 @@ void proc_enter_usermode() {
 ft_entry_t* proc_fd_to_entry(uint32_t fd) {
     ft_entry_t* ent;
 
-    list_for_each_entry(ent, &current_process->filetable) {
+    list_for_each_entry(ent, &current_leader->filetable) {
         if (ent->fd == fd) {
             return ent;
         }
@@ -268,7 +571,7 @@ void proc_release_fd(uint32_t fd) {
     ft_entry_t* ent;
     list_t* iter;
 
-    list_for_each(iter, ent, &current_process->filetable) {
+    list_for_each(iter, ent, &current_leader->filetable) {
         if (ent->fd == fd) {
             list_del(iter);
             ent->refcount--;
@@ -277,7 +580,7 @@ void proc_release_fd(uint32_t fd) {
                 /* TODO: this is out of place... the fs doesn't care about
                  * "open" or "close" */
                 fs_close(ent->inode);
-                free(ent);
+                kmem_cache_free(ft_entry_cache, ent);
             }
 
             break;
@@ -285,6 +588,16 @@ void proc_release_fd(uint32_t fd) {
     }
 }
 
+/* Returns a zeroed filetable entry.
+ */
+ft_entry_t* proc_new_ft_entry() {
+    ft_entry_t* ent = kmem_cache_alloc(ft_entry_cache);
+
+    memset(ent, 0, sizeof(ft_entry_t));
+
+    return ent;
+}
+
 /* Adds or replaces a file descriptor for the current process.
  * Increments the refcount of the passed entry.
  */
@@ -292,7 +605,7 @@ void proc_add_fd(ft_entry_t* entry) {
     ft_entry_t* ent;
     list_t* iter;
 
-    list_for_each(iter, ent, &current_process->filetable) {
+    list_for_each(iter, ent, &current_leader->filetable) {
         if (ent->fd == entry->fd) {
             proc_release_fd(ent->fd);
             break;
@@ -300,7 +613,7 @@ void proc_add_fd(ft_entry_t* entry) {
     }
 
     entry->refcount++;
-    list_add_front(&current_process->filetable, entry);
+    list_add_front(&current_leader->filetable, entry);
 }
 
 /* Returns a new and unused fd for the current process.
@@ -312,39 +625,95 @@ uint32_t proc_next_fd() {
     return avail++;
 }
 
-/* Terminates the currently executing process.
- * Implements the `exit` system call.
+/* Terminates the currently executing thread, and its process with it if it
+ * was the last one: the other threads of a process keep running when the
+ * thread that started it exits this way.
+ * Implements the `thread_exit` system call, `value` being what
+ * `proc_thread_join` returns.
  */
-void proc_exit() {
-    // Free allocated pages: code, heap, stack, page directory
-    directory_entry_t* pd = (directory_entry_t*) 0xFFFFF000;
+void proc_exit(uint32_t value) {
+    process_t* leader = current_leader;
 
-    for (uint32_t i = 0; i < 768; i++) {
-        if (!(pd[i] & PAGE_PRESENT)) {
-            continue;
-        }
+    // We're about to free the page directory we run in, and won't be back
+    CLI();
 
-        uintptr_t page = pd[i] & PAGE_FRAME;
-        pmm_free_page(page);
+    kfree(dead_process);
+    dead_process = NULL;
+
+    // The other threads are freed with the address space, or when joined
+    if (--leader->num_threads == 0) {
+        proc_release_address_space();
+        dead_process = current_process;
     }
 
-    uintptr_t pd_page = pd[1023] & PAGE_FRAME;
-    pmm_free_page(pd_page);
+    // We're still running on our kernel stack, it'll be freed later on
+    kfree(dead_kernel_stack);
+    dead_kernel_stack = (void*) (current_process->kernel_stack - 0x1000 * PROC_KERNEL_STACK_PAGES + 4);
 
-    // Free the kernel stack
-    kfree((void*) (current_process->kernel_stack - 0x1000 * PROC_KERNEL_STACK_PAGES + 4));
+    fpu_exit(current_process);
 
-    // Free the file descriptor list
-    while (!list_empty(&current_process->filetable)) {
-        ft_entry_t* ent = list_first_entry(&current_process->filetable, ft_entry_t);
-        proc_release_fd(ent->fd);
+    current_process->exited = true;
+
+    if (current_process != leader) {
+        current_process->exit_value = value;
+        wait_queue_wake_all(&current_process->join_queue);
     }
 
     // This last line is actually safe, and necessary
-    scheduler->sched_exit(scheduler, current_process);
+    cpu_t* cpu = cpu_get_current();
+    cpu->num_processes--;
+    cpu->scheduler->sched_exit(cpu->scheduler, current_process);
     proc_schedule();
 }
 
+/* Gets `thread` off the CPU or out of its sleep, for it to notice that its
+ * process is exiting.
+ */
+static void proc_kill_thread(process_t* thread) {
+    cpu_t* cpu = &cpus[thread->cpu];
+
+    if (thread == current_process || thread->exited) {
+        return;
+    }
+
+    if (cpu->current == thread) {
+        smp_kick(cpu);
+    } else {
+        proc_wake(thread);
+    }
+}
+
+/* Terminates the current process with all of its threads, recording `status`
+ * in its leader. Threads are only terminated on their way back to userspace,
+ * where they hold nothing, see `proc_check_exit`: sleeping ones are woken up,
+ * and waits give up early, see `wait_queue_interrupted`.
+ * Implements the `exit` system call.
+ */
+void proc_exit_process(uint32_t status) {
+    process_t* leader = current_leader;
+    process_t* thread;
+
+    leader->exiting = true;
+    leader->exit_value = status;
+
+    proc_kill_thread(leader);
+
+    list_for_each_entry(thread, &leader->threads) {
+        proc_kill_thread(thread);
+    }
+
+    proc_exit(status);
+}
+
+/* Terminates the current thread if its process is exiting. Called when the
+ * thread enters or leaves the kernel, see `proc_exit_process`.
+ */
+void proc_check_exit() {
+    if (current_leader->exiting) {
+        proc_exit(current_leader->exit_value);
+    }
+}
+
 uint32_t proc_get_current_pid() {
     if (current_process) {
         return current_process->pid;
@@ -357,58 +726,283 @@ uint32_t proc_get_current_pid() {
  * directory.
  */
 char* proc_get_cwd() {
-    return strdup(current_process->cwd);
+    return strdup(current_leader->cwd);
+}
+
+process_t* proc_get_current() {
+    return current_process;
 }
 
 void proc_sleep(uint32_t ms) {
-    current_process->sleep_ticks = (uint32_t) ((ms*TIMER_FREQ)/1000.0);
+    current_process->sleep_ticks = ms*TIMER_FREQ / 1000;
+    proc_schedule();
+}
+
+/* Suspends the current process until `proc_wake` is called on it, or for at
+ * most `ms` milliseconds if it isn't zero. See `wait_queue.c`.
+ */
+void proc_block(uint32_t ms) {
+    current_process->sleep_ticks = ms ? divide_up(ms*TIMER_FREQ, 1000) : PROC_SLEEP_FOREVER;
     proc_schedule();
+    current_process->sleep_ticks = 0;
+}
+
+void proc_wake(process_t* process) {
+    uint32_t eflags = irq_save();
+    cpu_t* cpu = &cpus[process->cpu];
+
+    cpu->scheduler->sched_wake(cpu->scheduler, process);
+    smp_reschedule(cpu);
+    irq_restore(eflags);
 }
 
 /* Extends the program's writeable memory by `size` bytes.
- * Note: the real granularity is by the page, but the program doesn't need the
- * details.
+ * Pages are only reserved here, they're allocated when first accessed.
  */
 void* proc_sbrk(intptr_t size) {
-    uintptr_t end = 0x1000 + 0x1000*current_process->code_len + current_process->mem_len;
-
-    // Bytes available in the last allocated page
-    int32_t remaining_bytes = (end % 0x1000) ? (0x1000 - (end % 0x1000)) : 0;
+    proc_region_t* heap = current_leader->heap;
+    uintptr_t end = heap->end;
 
     if (size > 0) {
-        // We have to allocate more pages
-        if (remaining_bytes < size) {
-            uint32_t needed_size = size - remaining_bytes;
-            uint32_t num = divide_up(needed_size, 0x1000);
-
-            if (!paging_alloc_pages(align_to(end, 0x1000), num)) {
-                return (void*) -1;
-            }
+        // Don't run into shared pages, below the clock page and the stack
+        if (end + size > PROC_SHARED_BEGIN) {
+            return (void*) -1;
         }
     } else if (size < 0) {
-        if (end + size < 0x1000*current_process->code_len) {
+        if (end + size < heap->start) {
             return (void*) -1; // Can't deallocate the code
         }
 
-        int32_t taken = 0x1000 - remaining_bytes;
+        // Unmap the pages that end up entirely past the new end
+        uintptr_t first = align_to(end + size, 0x1000);
 
-        // We must free at least a page
-        if (taken + size < 0) {
-            uint32_t freed_size = taken - size; // Account for sign
-            uint32_t num = divide_up(freed_size, 0x1000);
+        for (uintptr_t virt = first; virt < align_to(end, 0x1000); virt += 0x1000) {
+            paging_unmap_page(virt);
+        }
+    }
 
-            // Align to the beginning of the last mapped page
-            uintptr_t virt = end - (end % 0x1000);
+    heap->end += size;
+    current_leader->mem_len += size;
 
-            for (uint32_t i = 0; i < num; i++) {
-                paging_unmap_page(virt - 0x1000*i);
+    return (void*) end;
+}
+
+/* Maps the `num` kernel pages at `addr`, from `paging_alloc_shared`, in the
+ * current process's address space too, writable. Returns where, or zero if
+ * there's no room left.
+ * The pages stay shared with a child after `proc_fork` instead of being
+ * copied on write.
+ */
+uintptr_t proc_map_shared(void* addr, uint32_t num) {
+    uintptr_t start = PROC_SHARED_BEGIN;
+    proc_region_t* region;
+    bool overlaps = true;
+
+    // Find the first gap large enough between shared regions
+    while (overlaps && start + num*0x1000 <= PROC_SHARED_END) {
+        overlaps = false;
+
+        list_for_each_entry(region, &current_leader->regions) {
+            if (region->start < start + num*0x1000 && region->end > start) {
+                start = region->end;
+                overlaps = true;
+                break;
             }
         }
     }
 
-    current_process->mem_len += size;
+    if (overlaps) {
+        return 0;
+    }
 
-    return (void*) end;
+    region = proc_add_region(current_leader, start, start + num*0x1000);
+    region->flags = PAGE_USER | PAGE_RW | PAGE_SHARED;
+
+    for (uint32_t i = 0; i < num; i++) {
+        uintptr_t frame = paging_virt_to_phys((uintptr_t) addr + i*0x1000);
+
+        pmm_ref_page(frame);
+        paging_map_page(start + i*0x1000, frame, region->flags);
+    }
+
+    return start;
+}
+
+/* Unmaps pages mapped by `proc_map_shared` at `addr` from the current
+ * process.
+ */
+void proc_unmap_shared(uintptr_t addr) {
+    proc_region_t* region;
+    list_t* iter;
+
+    list_for_each(iter, region, &current_leader->regions) {
+        if (region->start == addr && region->flags & PAGE_SHARED) {
+            paging_unmap_pages(region->start, (region->end - region->start) / 0x1000);
+            list_del(iter);
+            kfree(region);
+
+            return;
+        }
+    }
+}
+
+/* Handles a page fault at `addr` in one of the current process's regions, with
+ * `err` the error code pushed by the CPU. Returns whether the fault was
+ * resolved, i.e. whether:
+ *  - the page wasn't backed yet, in which case it's mapped from the page cache
+ *    or to a zeroed frame depending on the region;
+ *  - the page was written to while shared, in which case it's copied.
+ * Pages are filled before being mapped, as threads running on other CPUs may
+ * use them as soon as they are.
+ */
+bool proc_handle_fault(uintptr_t addr, uint32_t err) {
+    if (!current_process || addr >= KERNEL_BASE_VIRT) {
+        return false;
+    }
+
+    proc_region_t* region;
+    list_for_each_entry(region, &current_leader->regions) {
+        if (addr < region->start || addr >= region->end) {
+            continue;
+        }
+
+        uintptr_t page = addr & PAGE_FRAME;
+        page_t* entry = paging_get_page(page, false, 0);
+
+        // Another thread may have had the same fault handled meanwhile, the
+        // access is then just retried
+        if (!(err & 0x01) && entry && *entry & PAGE_PRESENT) {
+            return true;
+        }
+
+        if (err & 0x01) {
+            // Writing to a read-only page of a writable region
+            if (!(err & 0x02) || !(region->flags & PAGE_RW)) {
+                return false;
+            }
+
+            proc_copy_on_write(page, region->flags);
+        } else if (region->fs && page - region->start < region->file_size) {
+            uint32_t index = (region->file_offset + page - region->start) / 0x1000;
+            uintptr_t frame = page_cache_get(region->fs, region->inode_no, index);
+            uint32_t size = region->file_size - (page - region->start);
+
+            if (size < 0x1000) {
+                // The rest of the page isn't part of the file-backed data,
+                // e.g. the start of .bss: it gets its own copy, zeroed. There's
+                // a single temporary mapping, hence the bounce buffer.
+                uintptr_t copy = pmm_alloc_page();
+                uint8_t* data = kmalloc(size);
+
+                memcpy(data, paging_map_temp(frame), size);
+                uint8_t* dst = paging_map_temp(copy);
+                memcpy(dst, data, size);
+                memset(dst + size, 0, 0x1000 - size);
+
+                kfree(data);
+                pmm_unref_page(frame);
+                paging_map_page(page, copy, region->flags);
+            } else {
+                paging_map_page(page, frame, region->flags & ~PAGE_RW);
+
+                if (err & 0x02) {
+                    proc_copy_on_write(page, region->flags);
+                }
+            }
+        } else {
+            uintptr_t frame = pmm_alloc_page();
+
+            memset(paging_map_temp(frame), 0, 0x1000);
+            paging_map_page(page, frame, region->flags);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+/* Gives the process its own copy of the frame mapped read-only at `page`, and
+ * maps it with `flags`. The copy is skipped if nobody else uses the frame.
+ */
+static void proc_copy_on_write(uintptr_t page, uint32_t flags) {
+    page_t* entry = paging_get_page(page, false, 0);
+    uintptr_t frame = *entry & PAGE_FRAME;
+
+    if (pmm_get_refcount(frame) > 1) {
+        uintptr_t copy = pmm_alloc_page();
+
+        // Other threads may keep reading the frame until they flush it
+        memcpy(paging_map_temp(copy), (void*) page, 0x1000);
+        *entry = copy | PAGE_PRESENT | (flags & PAGE_FLAGS);
+        paging_invalidate_page(page);
+        smp_flush_user_tlbs();
+        pmm_unref_page(frame);
+    } else {
+        *entry = frame | PAGE_PRESENT | (flags & PAGE_FLAGS);
+        paging_invalidate_page(page);
+    }
+}
+
+/* Adds a region to the process's address space, whose pages are mapped as
+ * needed.
+ */
+static proc_region_t* proc_add_region(process_t* process, uintptr_t start, uintptr_t end) {
+    proc_region_t* region = kmalloc(sizeof(proc_region_t));
+
+    *region = (proc_region_t) {
+        .start = start,
+        .end = end,
+        .flags = PAGE_USER | PAGE_RW,
+        .fs = NULL
+    };
+
+    list_add(&process->regions, region);
+
+    return region;
+}
+
+/* Reads and checks the header of the ELF executable `in` into `header`, and
+ * returns its program headers, to be freed by the caller. Returns NULL if the
+ * file can't be run.
+ */
+static elf_phdr_t* proc_read_elf(inode_t* in, elf_header_t* header) {
+    uint32_t read = fs_read(in, 0, (uint8_t*) header, sizeof(elf_header_t));
+
+    if (read != sizeof(elf_header_t) || header->magic != ELF_MAGIC ||
+            header->class != ELF_CLASS_32 || header->data != ELF_DATA_LSB ||
+            header->type != ELF_TYPE_EXEC || header->machine != ELF_MACHINE_386 ||
+            header->phentsize != sizeof(elf_phdr_t) || !header->phnum ||
+            header->phnum > 0x1000 / sizeof(elf_phdr_t)) {
+        return NULL;
+    }
+
+    uint32_t size = header->phnum * sizeof(elf_phdr_t);
+    elf_phdr_t* phdrs = kmalloc(size);
+
+    if (fs_read(in, header->phoff, (uint8_t*) phdrs, size) != size) {
+        kfree(phdrs);
+        return NULL;
+    }
+
+    // Segments must fit below the stack, and be mappable page by page
+    uintptr_t stack_bottom = 0xC0000000 - 0x1000*PROC_STACK_PAGES;
+
+    for (uint32_t i = 0; i < header->phnum; i++) {
+        elf_phdr_t* ph = &phdrs[i];
+
+        if (ph->type != ELF_PT_LOAD) {
+            continue;
+        }
+
+        if (ph->vaddr < 0x1000 || ph->memsz > stack_bottom - ph->vaddr ||
+                ph->filesz > ph->memsz || ph->offset % 0x1000 != ph->vaddr % 0x1000) {
+            kfree(phdrs);
+            return NULL;
+        }
+    }
+
+    return phdrs;
 }
 
 int32_t proc_exec(const char* path, char** argv) {
@@ -419,23 +1013,20 @@ int32_t proc_exec(const char* path, char** argv) {
         return -1;
     }
 
-    uint8_t* data = kmalloc(in->size);
-    uint32_t read = fs_read(in, 0, data, in->size);
-
-    if (read == in->size && in->size) {
-        process_t* p = proc_run_code(data, in->size, argv);
+    process_t* p = proc_run_image(in, argv);
 
+    if (p) {
         // Clone file descriptors
         if (proc_get_current_pid()) {
             ft_entry_t* ent;
 
-            list_for_each_entry(ent, &current_process->filetable) {
+            list_for_each_entry(ent, &current_leader->filetable) {
                 ent->refcount++;
                 list_add_front(&p->filetable, ent);
             }
         }
     } else {
-        printke("exec failed while reading the executable");
+        printke("exec failed: %s isn't a valid executable", path);
         return -1;
     }
 
@@ -446,7 +1037,7 @@ uint32_t proc_open(const char* path, uint32_t flags) {
     inode_t* in = fs_open((char*) path, flags); // TODO
 
     if (in) {
-        ft_entry_t* ent = kmalloc(sizeof(ft_entry_t));
+        ft_entry_t* ent = proc_new_ft_entry();
 
         ent->fd = proc_next_fd();
         ent->inode = in;
@@ -456,7 +1047,7 @@ uint32_t proc_open(const char* path, uint32_t flags) {
         ent->index = 0;
         ent->refcount = 1;
 
-        list_add_front(&current_process->filetable, ent);
+        list_add_front(&current_leader->filetable, ent);
 
         return ent->fd;
     }
@@ -467,7 +1058,7 @@ uint32_t proc_open(const char* path, uint32_t flags) {
 void proc_close(uint32_t fd) {
     list_t* iter;
     ft_entry_t* ent;
-    list_for_each(iter, ent, &current_process->filetable) {
+    list_for_each(iter, ent, &current_leader->filetable) {
         if (ent->fd == fd) {
             // TODO: At some point, we'll want to have a fs-layer writelock
             fs_close(ent->inode);
@@ -563,8 +1154,219 @@ int32_t proc_chdir(const char* path) {
         return -1;
     }
 
-    kfree(current_process->cwd);
-    current_process->cwd = npath;
+    kfree(current_leader->cwd);
+    current_leader->cwd = npath;
 
     return 0;
-}
\ No newline at end of file
+}
+/* Builds the kernel stack of a new process or thread as if it had been
+ * interrupted by the system call that created it, with `regs` as its
+ * userspace state, see `proc_run_image`. Returns the copy of `regs` it'll
+ * return to userspace with.
+ */
+static registers_t* proc_setup_kernel_stack(process_t* process, registers_t* regs) {
+    registers_t* new_regs = (registers_t*) (process->kernel_stack - sizeof(registers_t));
+    *new_regs = *regs;
+
+    uint32_t* kstack = (uint32_t*) new_regs;
+    *(--kstack) = (uintptr_t) &irq_handler_end; // `proc_switch_process`'s `ret`
+    *(--kstack) = 0; // %ebx
+    *(--kstack) = 0; // %esi
+    *(--kstack) = 0; // %edi
+    *(--kstack) = 0; // %ebp
+
+    process->saved_kernel_stack = (uintptr_t) kstack;
+    process->initial_user_stack = regs->esp;
+
+    return new_regs;
+}
+
+/* Returns the item of the current process's thread list holding the thread
+ * `tid`, NULL if there's none.
+ */
+static list_t* proc_find_thread(uint32_t tid) {
+    list_t* iter;
+    process_t* thread;
+
+    list_for_each(iter, thread, &current_leader->threads) {
+        if (thread->pid == tid) {
+            return iter;
+        }
+    }
+
+    return NULL;
+}
+
+/* Frees what the threads of the current process shared, when the last one
+ * exits: its pages, page tables and page directory, regions and files, as
+ * well as the threads that weren't joined.
+ */
+static void proc_release_address_space() {
+    directory_entry_t* pd = (directory_entry_t*) 0xFFFFF000;
+    process_t* leader = current_leader;
+
+    for (uint32_t i = 0; i < 768; i++) {
+        if (!(pd[i] & PAGE_PRESENT)) {
+            continue;
+        }
+
+        page_t* table = (page_t*) (0xFFC00000 + (i << 12));
+
+        for (uint32_t j = 0; j < 1024; j++) {
+            if (table[j] & PAGE_PRESENT) {
+                pmm_unref_page(table[j] & PAGE_FRAME);
+            }
+        }
+
+        uintptr_t page = pd[i] & PAGE_FRAME;
+        pmm_free_page(page);
+    }
+
+    uintptr_t pd_page = pd[1023] & PAGE_FRAME;
+    pmm_free_page(pd_page);
+
+    while (!list_empty(&leader->regions)) {
+        kfree(list_first_entry(&leader->regions, proc_region_t));
+        list_del(list_first(&leader->regions));
+    }
+
+    // Free the file descriptor list
+    while (!list_empty(&leader->filetable)) {
+        ft_entry_t* ent = list_first_entry(&leader->filetable, ft_entry_t);
+        proc_release_fd(ent->fd);
+    }
+
+    kfree(leader->cwd);
+
+    // The exiting thread itself is still needed until we switch away from it,
+    // it's freed by the next one to exit, see `proc_exit`
+    while (!list_empty(&leader->threads)) {
+        process_t* thread = list_first_entry(&leader->threads, process_t);
+
+        if (thread != current_process) {
+            kfree(thread);
+        }
+
+        list_del(list_first(&leader->threads));
+    }
+
+    if (leader != current_process) {
+        kfree(leader);
+    }
+}
+
+static cpu_t* proc_least_loaded_cpu() {
+    cpu_t* cpu = &cpus[0];
+
+    for (uint32_t i = 1; i < num_cpus; i++) {
+        if (cpus[i].num_processes < cpu->num_processes) {
+            cpu = &cpus[i];
+        }
+    }
+
+    return cpu;
+}
+
+/* Hands a new process to `cpu`, where it'll stay.
+ */
+static void proc_add_to_cpu(process_t* process, cpu_t* cpu) {
+    uint32_t eflags = irq_save();
+
+    process->cpu = cpu->id;
+    cpu->num_processes++;
+    cpu->scheduler->sched_add(cpu->scheduler, process);
+    smp_reschedule(cpu);
+    irq_restore(eflags);
+}
+
+/* Creates a process that runs `entry` in the kernel's page directory, on
+ * `cpu`, without ever returning to userspace. It isn't known to the scheduler:
+ * idle processes are only switched to when the scheduler has nothing to run,
+ * see `proc_run_kernel_thread` for the others.
+ */
+static process_t* proc_new_kernel_process(uint32_t cpu, uint32_t pid, void (*entry)()) {
+    process_t* process = aligned_alloc(16, sizeof(process_t));
+    uintptr_t kernel_stack = (uintptr_t) aligned_alloc(4, 0x1000 * PROC_KERNEL_STACK_PAGES);
+    uint32_t* kstack = (uint32_t*) (kernel_stack + PROC_KERNEL_STACK_PAGES * 0x1000 - 4);
+
+    *process = (process_t) {
+        .pid = pid,
+        .directory = paging_get_kernel_directory(),
+        .kernel_stack = (uintptr_t) kstack,
+        .filetable = LIST_HEAD_INIT(process->filetable),
+        .regions = LIST_HEAD_INIT(process->regions),
+        .cpu = cpu,
+        .leader = process,
+        .threads = LIST_HEAD_INIT(process->threads),
+        .num_threads = 1,
+        .join_queue = WAIT_QUEUE_INIT(process->join_queue)
+    };
+
+    *(--kstack) = 0; // `entry`'s return address, unused
+    *(--kstack) = (uintptr_t) entry; // `proc_switch_process`'s `ret`
+    *(--kstack) = 0; // %ebx
+    *(--kstack) = 0; // %esi
+    *(--kstack) = 0; // %edi
+    *(--kstack) = 0; // %ebp
+
+    process->saved_kernel_stack = (uintptr_t) kstack;
+
+    return process;
+}
+
+/* Halts the CPU until there's something to run. Its timer is set to fire
+ * when the first of its sleeping processes is due to wake up instead of on
+ * every tick, which is undone by `proc_schedule` when switching away from
+ * here. The bootstrap processor also waits for other CPUs' sleeping
+ * processes: the tick counter only moves with its timer, see `timer.c`.
+ * Any other interrupt can make a process runnable in the meantime, e.g. input,
+ * or a process on another CPU, see `smp_reschedule`.
+ */
+static void proc_idle() {
+    cpu_t* cpu = cpu_get_current();
+
+    while (true) {
+        proc_schedule();
+
+        uint32_t ticks = UINT32_MAX;
+
+        for (uint32_t i = 0; i < num_cpus; i++) {
+            sched_t* scheduler = cpus[i].scheduler;
+            uint32_t wakeup = 0;
+
+            if (i != cpu->id && cpu->id != 0) {
+                continue;
+            }
+
+            if (!scheduler->sched_next_wakeup) {
+                ticks = 1;
+            } else if ((wakeup = scheduler->sched_next_wakeup(scheduler))) {
+                // Other CPUs wake their own sleepers on their next tick
+                int32_t left = wakeup - timer_get_tick();
+                left = left < (i != cpu->id) ? (i != cpu->id) : left;
+                ticks = (uint32_t) left < ticks ? (uint32_t) left : ticks;
+            }
+        }
+
+        if (!ticks) {
+            continue;
+        }
+
+        timer_set_oneshot(ticks);
+
+        // The bootstrap processor may not know about our sleepers yet
+        if (cpu->id != 0 && ticks != UINT32_MAX &&
+                !timer_ticks_by(timer_get_tick() + ticks)) {
+            smp_reschedule(&cpus[0]);
+        }
+
+        // Interrupts are only enabled while halted, `sti` taking effect after
+        // `hlt` has started so that no wake-up is missed. Other CPUs may run
+        // kernel code in the meantime.
+        kernel_unlock();
+        asm volatile("sti\n"
+                     "hlt\n"
+                     "cli");
+        kernel_lock();
+    }
+}
@@ -0,0 +1,327 @@
+#include <kernel/sched_mlfq.h>
+#include <kernel/slab.h>
+#include <kernel/sys.h>
+#include <kernel/timer.h>
+
+#include <stdlib.h>
+
+#define MLFQ_LEVELS 4
+#define MLFQ_BOOST_TICKS (2*TIMER_FREQ) // Period of the anti-starvation boost
+
+// Time slice of each level, in ticks
+static const uint32_t mlfq_quantum[MLFQ_LEVELS] = { 1, 2, 4, 8 };
+
+/* Wraps a `process_t*` in either a run queue or the sleep queue.
+ */
+typedef struct _mlfq_node_t {
+    process_t* process;
+    struct _mlfq_node_t* next;
+    struct _mlfq_node_t* prev;
+    uint32_t level;
+    uint32_t ticks_used; // Ticks spent running at the current level
+    uint32_t wake_tick;
+} mlfq_node_t;
+
+typedef struct {
+    mlfq_node_t* head;
+    mlfq_node_t* tail;
+} mlfq_queue_t;
+
+/* The multilevel feedback queue scheduler keeps one run queue per priority
+ * level, with a bitmap of the non-empty ones so that picking the next process
+ * doesn't depend on how many there are.
+ * Processes start at the highest priority, level 0, and are demoted when they
+ * use up their time slice. Processes that sleep are moved out of the run
+ * queues to a queue sorted by wake-up time, and go back to level 0 when they
+ * wake up or are woken up, e.g. by user input: interactive processes stay
+ * responsive.
+ * The running process isn't part of any queue.
+ */
+typedef struct {
+    sched_t sched;
+    mlfq_node_t* current;
+    mlfq_queue_t levels[MLFQ_LEVELS];
+    uint32_t bitmap;
+    mlfq_node_t* sleeping;
+    uint32_t last_tick;
+    uint32_t last_boost;
+} sched_mlfq_t;
+
+static kmem_cache_t* node_cache;
+
+static void mlfq_push(sched_mlfq_t* sc, mlfq_node_t* node, bool front);
+static mlfq_node_t* mlfq_pop(sched_mlfq_t* sc);
+static void mlfq_remove(sched_mlfq_t* sc, mlfq_node_t* node);
+static void mlfq_sleep(sched_mlfq_t* sc, mlfq_node_t* node, uint32_t now);
+static void mlfq_wake_sleepers(sched_mlfq_t* sc, uint32_t now);
+static void mlfq_boost(sched_mlfq_t* sc);
+
+process_t* sched_mlfq_get_current(sched_t* sched) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+
+    if (!sc->current) {
+        sc->current = mlfq_pop(sc);
+    }
+
+    return sc->current ? sc->current->process : NULL;
+}
+
+void sched_mlfq_add(sched_t* sched, process_t* process) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_node_t* node = kmem_cache_alloc(node_cache);
+
+    *node = (mlfq_node_t) {
+        .process = process,
+        .level = 0
+    };
+
+    process->sched_data = node;
+    mlfq_push(sc, node, false);
+}
+
+/* Accounts for the time used by the running process and elects the next one.
+ * This is called on every timer tick, in which case `timer_get_tick` has
+ * changed since the last call, but also when a process gives up the CPU.
+ */
+process_t* sched_mlfq_next(sched_t* sched) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_node_t* node = sc->current;
+    uint32_t now = timer_get_tick();
+    bool tick = now != sc->last_tick;
+
+    sc->last_tick = now;
+    mlfq_wake_sleepers(sc, now);
+
+    if (now - sc->last_boost >= MLFQ_BOOST_TICKS) {
+        mlfq_boost(sc);
+        sc->last_boost = now;
+    }
+
+    if (node) {
+        node->ticks_used += tick;
+
+        if (node->process->sleep_ticks) {
+            mlfq_sleep(sc, node, now);
+        } else if (node->ticks_used >= mlfq_quantum[node->level]) {
+            if (node->level < MLFQ_LEVELS - 1) {
+                node->level++;
+            }
+
+            node->ticks_used = 0;
+            mlfq_push(sc, node, false);
+        } else if (!tick || (sc->bitmap & ((1 << node->level) - 1))) {
+            // The process yielded, or is preempted by a higher priority one:
+            // it keeps what's left of its time slice
+            mlfq_push(sc, node, tick);
+        } else {
+            return node->process;
+        }
+    }
+
+    sc->current = mlfq_pop(sc);
+
+    // Nothing may be runnable, in which case the idle task runs
+    return sc->current ? sc->current->process : NULL;
+}
+
+void sched_mlfq_exit(sched_t* sched, process_t* process) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_node_t* node = process->sched_data;
+
+    if (node == sc->current) {
+        sc->current = NULL;
+    } else {
+        mlfq_remove(sc, node);
+    }
+
+    kmem_cache_free(node_cache, node);
+}
+
+void sched_mlfq_wake(sched_t* sched, process_t* process) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_node_t* node = process->sched_data;
+
+    process->sleep_ticks = 0;
+
+    if (node->wake_tick) {
+        mlfq_remove(sc, node);
+        node->level = 0;
+        node->ticks_used = 0;
+        mlfq_push(sc, node, false);
+    }
+}
+
+uint32_t sched_mlfq_next_wakeup(sched_t* sched) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+
+    return sc->sleeping ? sc->sleeping->wake_tick : 0;
+}
+
+/* Allocates a multilevel feedback queue scheduler.
+ */
+sched_t* sched_mlfq() {
+    sched_mlfq_t* sched = kmalloc(sizeof(sched_mlfq_t));
+
+    if (!node_cache) {
+        node_cache = kmem_cache_create("mlfq_node", sizeof(mlfq_node_t));
+    }
+
+    *sched = (sched_mlfq_t) {
+        .sched = (sched_t) {
+            .sched_get_current = sched_mlfq_get_current,
+            .sched_add = sched_mlfq_add,
+            .sched_next = sched_mlfq_next,
+            .sched_exit = sched_mlfq_exit,
+            .sched_wake = sched_mlfq_wake,
+            .sched_next_wakeup = sched_mlfq_next_wakeup
+        },
+        .current = NULL,
+        .bitmap = 0,
+        .sleeping = NULL
+    };
+
+    return (sched_t*) sched;
+}
+
+/* Adds a node at the back, or the front, of the run queue of its level.
+ */
+static void mlfq_push(sched_mlfq_t* sc, mlfq_node_t* node, bool front) {
+    mlfq_queue_t* queue = &sc->levels[node->level];
+
+    if (!queue->head) {
+        node->next = node->prev = NULL;
+        queue->head = queue->tail = node;
+    } else if (front) {
+        node->prev = NULL;
+        node->next = queue->head;
+        queue->head->prev = node;
+        queue->head = node;
+    } else {
+        node->next = NULL;
+        node->prev = queue->tail;
+        queue->tail->next = node;
+        queue->tail = node;
+    }
+
+    sc->bitmap |= 1 << node->level;
+}
+
+/* Removes and returns the first node of the highest priority non-empty run
+ * queue, NULL if there are none.
+ */
+static mlfq_node_t* mlfq_pop(sched_mlfq_t* sc) {
+    if (!sc->bitmap) {
+        return NULL;
+    }
+
+    mlfq_node_t* node = sc->levels[__builtin_ctz(sc->bitmap)].head;
+    mlfq_remove(sc, node);
+
+    return node;
+}
+
+/* Removes a node from whichever queue it's in.
+ */
+static void mlfq_remove(sched_mlfq_t* sc, mlfq_node_t* node) {
+    if (node->wake_tick) {
+        if (node->prev) {
+            node->prev->next = node->next;
+        } else {
+            sc->sleeping = node->next;
+        }
+
+        if (node->next) {
+            node->next->prev = node->prev;
+        }
+
+        node->wake_tick = 0;
+
+        return;
+    }
+
+    mlfq_queue_t* queue = &sc->levels[node->level];
+
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        queue->head = node->next;
+    }
+
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        queue->tail = node->prev;
+    }
+
+    if (!queue->head) {
+        sc->bitmap &= ~(1 << node->level);
+    }
+}
+
+/* Moves a process to the sleep queue, which is kept sorted by wake-up time.
+ */
+static void mlfq_sleep(sched_mlfq_t* sc, mlfq_node_t* node, uint32_t now) {
+    // Keep wake-up ticks comparable, even for `PROC_SLEEP_FOREVER`
+    uint32_t ticks = node->process->sleep_ticks;
+    ticks = ticks > INT32_MAX ? INT32_MAX : ticks;
+
+    // Zero means "not sleeping"
+    node->wake_tick = now + ticks;
+    node->wake_tick += !node->wake_tick;
+
+    mlfq_node_t* prev = NULL;
+    mlfq_node_t* next = sc->sleeping;
+
+    while (next && (int32_t) (next->wake_tick - node->wake_tick) <= 0) {
+        prev = next;
+        next = next->next;
+    }
+
+    node->prev = prev;
+    node->next = next;
+
+    if (prev) {
+        prev->next = node;
+    } else {
+        sc->sleeping = node;
+    }
+
+    if (next) {
+        next->prev = node;
+    }
+}
+
+/* Moves the processes whose sleep is over back to the highest priority queue.
+ */
+static void mlfq_wake_sleepers(sched_mlfq_t* sc, uint32_t now) {
+    while (sc->sleeping && (int32_t) (now - sc->sleeping->wake_tick) >= 0) {
+        mlfq_node_t* node = sc->sleeping;
+
+        mlfq_remove(sc, node);
+        node->process->sleep_ticks = 0;
+        node->level = 0;
+        node->ticks_used = 0;
+        mlfq_push(sc, node, false);
+    }
+}
+
+/* Moves every runnable process back to level 0, so that processes stuck in
+ * lower levels get some CPU time eventually.
+ */
+static void mlfq_boost(sched_mlfq_t* sc) {
+    for (uint32_t level = 1; level < MLFQ_LEVELS; level++) {
+        while (sc->levels[level].head) {
+            mlfq_node_t* node = sc->levels[level].head;
+
+            mlfq_remove(sc, node);
+            node->level = 0;
+            node->ticks_used = 0;
+            mlfq_push(sc, node, false);
+        }
+    }
+
+    if (sc->current) {
+        sc->current->level = 0;
+        sc->current->ticks_used = 0;
+    }
+}
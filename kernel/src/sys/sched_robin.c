@@ -1,4 +1,5 @@
 #include <kernel/sched_robin.h>
+#include <kernel/slab.h>
 #include <kernel/sys.h>
 
 #include <stdlib.h>
@@ -19,6 +20,8 @@ typedef struct {
     proc_node_t* processes;
 } sched_robin_t;
 
+static kmem_cache_t* node_cache;
+
 process_t* sched_robin_get_current(sched_t* sched) {
     sched_robin_t* sc = (sched_robin_t*) sched;
 
@@ -31,7 +34,7 @@ process_t* sched_robin_get_current(sched_t* sched) {
 
 void sched_robin_add(sched_t* sched, process_t* new_process) {
     sched_robin_t* sc = (sched_robin_t*) sched;
-    proc_node_t* new = kmalloc(sizeof(proc_node_t));
+    proc_node_t* new = kmem_cache_alloc(node_cache);
 
     new->process = new_process;
 
@@ -50,6 +53,11 @@ process_t* sched_robin_next(sched_t* sched) {
     sched_robin_t* sc = (sched_robin_t*) sched;
     proc_node_t* p = sc->processes;
 
+    // The idle process runs then
+    if (!p) {
+        return NULL;
+    }
+
     // Avoid switching to a sleeping process if possible
     do {
         if (p->next->process->sleep_ticks > 0) {
@@ -90,8 +98,11 @@ void sched_robin_exit(sched_t* sched, process_t* process) {
     sched_robin_t* sc = (sched_robin_t*) sched;
     proc_node_t* p = sc->processes;
 
+    // Other CPUs may still have processes to run
     if (sc->processes == sc->processes->next) {
-        abort();
+        kmem_cache_free(node_cache, p);
+        sc->processes = NULL;
+        return;
     }
 
     while (p->next->process != process) {
@@ -103,7 +114,13 @@ void sched_robin_exit(sched_t* sched, process_t* process) {
 
     sc->processes = p;
 
-    kfree(to_remove);
+    kmem_cache_free(node_cache, to_remove);
+}
+
+void sched_robin_wake(sched_t* sched, process_t* process) {
+    UNUSED(sched);
+
+    process->sleep_ticks = 0;
 }
 
 /* Allocates a round robin scheduler.
@@ -111,11 +128,16 @@ void sched_robin_exit(sched_t* sched, process_t* process) {
 sched_t* sched_robin() {
     sched_robin_t* sched = kmalloc(sizeof(sched_robin_t));
 
+    if (!node_cache) {
+        node_cache = kmem_cache_create("proc_node", sizeof(proc_node_t));
+    }
+
     sched->sched = (sched_t) {
         .sched_get_current = sched_robin_get_current,
         .sched_add = sched_robin_add,
         .sched_next = sched_robin_next,
-        .sched_exit = sched_robin_exit
+        .sched_exit = sched_robin_exit,
+        .sched_wake = sched_robin_wake
     };
 
     sched->processes = NULL;
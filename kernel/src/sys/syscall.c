@@ -1,12 +1,16 @@
 #include <kernel/syscall.h>
+#include <kernel/clock.h>
 #include <kernel/pmm.h>
 #include <kernel/fs.h>
+#include <kernel/futex.h>
 #include <kernel/proc.h>
 #include <kernel/timer.h>
 #include <kernel/fb.h>
 #include <kernel/wm.h>
 #include <kernel/serial.h>
 #include <kernel/pipe.h>
+#include <kernel/slab.h>
+#include <kernel/smp.h>
 #include <kernel/sys.h> // for UNUSED macro
 
 #include <stdio.h>
@@ -39,6 +43,14 @@ static void syscall_unlink(registers_t* regs);
 static void syscall_rename(registers_t* regs);
 static void syscall_maketty(registers_t* regs);
 static void syscall_stat(registers_t* regs);
+static void syscall_fork(registers_t* regs);
+static void syscall_clock_gettime(registers_t* regs);
+static void syscall_thread_create(registers_t* regs);
+static void syscall_thread_exit(registers_t* regs);
+static void syscall_thread_join(registers_t* regs);
+static void syscall_futex_wait(registers_t* regs);
+static void syscall_futex_wake(registers_t* regs);
+static void syscall_nop(registers_t* regs);
 
 handler_t syscall_handlers[SYSCALL_NUM] = { 0 };
 
@@ -67,9 +79,27 @@ void init_syscall() {
     syscall_handlers[SYS_RENAME] = syscall_rename;
     syscall_handlers[SYS_MAKETTY] = syscall_maketty;
     syscall_handlers[SYS_STAT] = syscall_stat;
+    syscall_handlers[SYS_FORK] = syscall_fork;
+    syscall_handlers[SYS_CLOCK_GETTIME] = syscall_clock_gettime;
+    syscall_handlers[SYS_THREAD_CREATE] = syscall_thread_create;
+    syscall_handlers[SYS_THREAD_EXIT] = syscall_thread_exit;
+    syscall_handlers[SYS_THREAD_JOIN] = syscall_thread_join;
+    syscall_handlers[SYS_FUTEX_WAIT] = syscall_futex_wait;
+    syscall_handlers[SYS_FUTEX_WAKE] = syscall_futex_wake;
+    syscall_handlers[SYS_NOP] = syscall_nop;
 }
 
+/* System calls run with interrupts enabled, so that input and timers are
+ * serviced during long ones. Data shared with interrupt handlers is protected
+ * by disabling interrupts or with mutexes, see `mutex.c`.
+ * A process whose time is up while in a system call is only switched out at
+ * the end of it, or by long ones when they call `cond_resched`, see
+ * `proc_preempt`.
+ */
 static void syscall_handler(registers_t* regs) {
+    proc_check_exit();
+    STI();
+
     if (regs->eax < SYS_MAX && syscall_handlers[regs->eax]) {
         handler_t handler = syscall_handlers[regs->eax];
         regs->eax = 0;
@@ -77,6 +107,14 @@ static void syscall_handler(registers_t* regs) {
     } else {
         printke("unknown syscall %d", regs->eax);
     }
+
+    CLI();
+
+    if (cpu_get_current()->need_resched) {
+        proc_schedule();
+    }
+
+    proc_check_exit();
 }
 
 /* Convention:
@@ -93,10 +131,8 @@ static void syscall_yield(registers_t* regs) {
 }
 
 static void syscall_exit(registers_t* regs) {
-    UNUSED(regs);
-
-    // TODO: exit status?
-    proc_exit();
+    uint32_t status = regs->ebx;
+    proc_exit_process(status);
 }
 
 static void syscall_sleep(registers_t* regs) {
@@ -109,7 +145,7 @@ static void syscall_putchar(registers_t* regs) {
 }
 
 static void syscall_sbrk(registers_t* regs) {
-    uint32_t size = regs->ebx;
+    intptr_t size = (intptr_t) regs->ebx;
     regs->eax = (uint32_t) proc_sbrk(size);
 }
 
@@ -139,21 +175,13 @@ static void syscall_wm(registers_t* regs) {
                 wm_param_event_t* param = (wm_param_event_t*) regs->ecx;
                 wm_get_event(param->win_id, param->event);
             } break;
-        case WM_CMD_IS_HOVERED: {
-            /* TODO: replace by a combination of cursor events and their
-             * handling in the titlebar widget.
-             */
-            list_t* item = wm_get_window(regs->ecx);
-
-            if (item != NULL) {
-                wm_window_t* win = list_entry(item, wm_window_t);
-                regs->eax = wm_is_titlebar_being_hovered(win);
-            } else {
-                printke("the given window id (%d) is unknown", regs->ecx);
-                regs->eax = false;
-                break;
-            }
-        } break;
+        case WM_CMD_WAIT_EVENT: {
+                wm_param_wait_event_t* param = (wm_param_wait_event_t*) regs->ecx;
+                wm_wait_event(param->win_id, param->event, param->timeout);
+            } break;
+        case WM_CMD_IS_HOVERED:
+            regs->eax = wm_is_hovered(regs->ecx);
+            break;
         default:
             printke("wrong command: %d", cmd);
             regs->eax = -1;
@@ -174,12 +202,20 @@ static void syscall_info(registers_t* regs) {
     }
 
     if (request & SYS_INFO_UPTIME) {
-        info->uptime = timer_get_time();
+        info->uptime_ms = clock_get_ns() / 1000000;
     }
 
     if (request & SYS_INFO_LOG && info->kernel_log) {
         strcpy(info->kernel_log, serial_get_log());
     }
+
+    if (request & SYS_INFO_CACHES) {
+        info->num_caches = kmem_cache_get_info(info->caches, SYS_INFO_MAX_CACHES);
+    }
+
+    if (request & SYS_INFO_WM) {
+        wm_get_info(&info->wm);
+    }
 }
 
 static void syscall_exec(registers_t* regs) {
@@ -280,15 +316,28 @@ static void syscall_rename(registers_t* regs) {
     regs->eax = fs_rename(old_path, new_path);
 }
 
+/* Replaces the calling process's stdout with a pipe, which processes it
+ * executes inherit:
+ *     uint32_t syscall_maketty();
+ * Returns a new file descriptor reading from that pipe, which blocks until
+ * something is written.
+ */
 static void syscall_maketty(registers_t* regs) {
-    ft_entry_t* entry = zalloc(sizeof(ft_entry_t));
+    ft_entry_t* entry = proc_new_ft_entry();
 
     entry->fd = FS_STDOUT_FILENO;
     entry->inode = pipe_new();
 
     proc_add_fd(entry);
 
-    regs->eax = 0;
+    ft_entry_t* reader = proc_new_ft_entry();
+
+    reader->fd = proc_next_fd();
+    reader->inode = pipe_open_end(entry->inode, 0);
+
+    proc_add_fd(reader);
+
+    regs->eax = reader->fd;
 }
 
 static void syscall_stat(registers_t* regs) {
@@ -296,4 +345,101 @@ static void syscall_stat(registers_t* regs) {
     stat_t* buf = (stat_t*) regs->ecx;
 
     regs->eax = fs_stat(path, buf);
-}
\ No newline at end of file
+}
+
+/* Duplicates the calling process:
+ *     int32_t syscall_fork();
+ * Returns the child's pid to the parent and 0 to the child.
+ */
+static void syscall_fork(registers_t* regs) {
+    process_t* child = proc_fork(regs);
+
+    regs->eax = child->pid;
+}
+
+/* Reads the monotonic clock, see `clock.c`:
+ *     int32_t syscall_clock_gettime(uint32_t clock_id, struct timespec* ts);
+ * Returns -1 for unsupported clocks.
+ */
+static void syscall_clock_gettime(registers_t* regs) {
+    uint32_t clock_id = regs->ebx;
+    struct timespec* ts = (struct timespec*) regs->ecx;
+
+    if (clock_id != CLOCK_MONOTONIC) {
+        regs->eax = -1;
+        return;
+    }
+
+    uint64_t ns = clock_get_ns();
+
+    ts->tv_sec = ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+    regs->eax = 0;
+}
+
+/* Starts a thread sharing the calling process's memory and files:
+ *     uint32_t syscall_thread_create(void* entry, void* stack);
+ * It starts running at `entry` with `stack` as its stack pointer, and has
+ * nothing to return to: it ends with `syscall_thread_exit`. Returns its
+ * thread id.
+ */
+static void syscall_thread_create(registers_t* regs) {
+    uintptr_t entry = regs->ebx;
+    uintptr_t stack = regs->ecx;
+
+    regs->eax = proc_thread_create(regs, entry, stack)->pid;
+}
+
+/* Ends the calling thread:
+ *     void syscall_thread_exit(uint32_t value);
+ * `value` is what joining it returns.
+ */
+static void syscall_thread_exit(registers_t* regs) {
+    uint32_t value = regs->ebx;
+
+    proc_exit(value);
+}
+
+/* Waits for a thread of the calling process to exit:
+ *     int32_t syscall_thread_join(uint32_t tid, uint32_t* value);
+ * Stores the value it exited with in `value`. Returns -1 if there's no such
+ * thread.
+ */
+static void syscall_thread_join(registers_t* regs) {
+    uint32_t tid = regs->ebx;
+    uint32_t* value = (uint32_t*) regs->ecx;
+
+    regs->eax = proc_thread_join(tid, value);
+}
+
+/* Sleeps until woken up by `syscall_futex_wake`, if `*addr == expected`:
+ *     int32_t syscall_futex_wait(uint32_t* addr, uint32_t expected, uint32_t timeout_ms);
+ * A zero timeout waits forever. Returns -1 if the value differed or on
+ * timeout, see `futex.c`.
+ */
+static void syscall_futex_wait(registers_t* regs) {
+    uint32_t* addr = (uint32_t*) regs->ebx;
+    uint32_t expected = regs->ecx;
+    uint32_t timeout = regs->edx;
+
+    regs->eax = futex_wait(addr, expected, timeout);
+}
+
+/* Wakes threads sleeping on `addr`:
+ *     uint32_t syscall_futex_wake(uint32_t* addr, uint32_t count);
+ * Returns the number of threads woken up.
+ */
+static void syscall_futex_wake(registers_t* regs) {
+    uint32_t* addr = (uint32_t*) regs->ebx;
+    uint32_t count = regs->ecx;
+
+    regs->eax = futex_wake(addr, count);
+}
+
+/* Does nothing, for measuring the cost of entering and leaving the kernel:
+ *     uint32_t syscall_nop();
+ * Returns 0.
+ */
+static void syscall_nop(registers_t* regs) {
+    UNUSED(regs);
+}
@@ -0,0 +1,98 @@
+#include <kernel/wait_queue.h>
+#include <kernel/proc.h>
+
+static bool wait_queue_remove(wait_queue_t* queue, process_t* process);
+
+/* Blocks the current process until the queue is woken up, or until `timeout`
+ * milliseconds have passed if it isn't zero. Returns whether the process was
+ * woken up.
+ * As the kernel can't be preempted, checking for a condition and then calling
+ * this function can't miss a wake-up, unless the condition is changed by an
+ * interrupt handler: interrupts must then be disabled from the check on.
+ */
+bool wait_queue_sleep(wait_queue_t* queue, uint32_t timeout) {
+    process_t* process = proc_get_current();
+    uint32_t eflags = irq_save();
+
+    list_add(&queue->waiters, process);
+    proc_block(timeout);
+
+    bool woken = !wait_queue_remove(queue, process);
+    irq_restore(eflags);
+
+    return woken;
+}
+
+/* Like `wait_queue_sleep`, for a queue protected by `lock`, which the caller
+ * holds with interrupts disabled: it's released once we're queued, so that a
+ * condition checked under it can't change before then, and taken again
+ * before returning.
+ * Waking us up also takes the big kernel lock, which we hold until we're off
+ * the CPU: it can't happen between releasing `lock` and going to sleep.
+ */
+bool wait_queue_sleep_locked(wait_queue_t* queue, spinlock_t* lock, uint32_t timeout) {
+    process_t* process = proc_get_current();
+
+    list_add(&queue->waiters, process);
+    spin_unlock(lock);
+    proc_block(timeout);
+    spin_lock(lock);
+
+    return !wait_queue_remove(queue, process);
+}
+
+/* Makes the process that has been waiting on the queue the longest runnable
+ * again, if any.
+ */
+void wait_queue_wake_one(wait_queue_t* queue) {
+    uint32_t eflags = irq_save();
+
+    if (!list_empty(&queue->waiters)) {
+        process_t* process = list_first_entry(&queue->waiters, process_t);
+
+        list_del(list_first(&queue->waiters));
+        proc_wake(process);
+    }
+
+    irq_restore(eflags);
+}
+
+/* Makes every process waiting on the queue runnable again.
+ */
+void wait_queue_wake_all(wait_queue_t* queue) {
+    uint32_t eflags = irq_save();
+
+    while (!list_empty(&queue->waiters)) {
+        process_t* process = list_first_entry(&queue->waiters, process_t);
+
+        list_del(list_first(&queue->waiters));
+        proc_wake(process);
+    }
+
+    irq_restore(eflags);
+}
+
+/* Returns whether the current process should stop waiting altogether, as it's
+ * being terminated: it's woken up without being taken off the queue then, see
+ * `proc_exit_process`.
+ */
+bool wait_queue_interrupted() {
+    return proc_get_current()->leader->exiting;
+}
+
+/* Takes `process` out of the queue if it's still in it, i.e. if nobody woke
+ * it up. Returns whether it was.
+ */
+static bool wait_queue_remove(wait_queue_t* queue, process_t* process) {
+    list_t* iter;
+    process_t* p;
+
+    list_for_each(iter, p, &queue->waiters) {
+        if (p == process) {
+            list_del(iter);
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,113 @@
+#include <kernel/irq.h>
+#include <kernel/proc.h>
+#include <kernel/smp.h>
+#include <kernel/wait_queue.h>
+#include <kernel/work.h>
+
+#include <string.h>
+
+/* Interrupt handlers should return quickly: whatever takes longer than
+ * acknowledging the device and saving its data, e.g. compositing the screen
+ * when the mouse moves, is scheduled as work instead.
+ * Work runs in order in a kernel thread, with interrupts enabled, so that it
+ * may take locks and sleep. Work scheduled again before it got to run only
+ * runs once: it should handle everything its interrupt handler queued, see
+ * `work_ring_t`.
+ */
+static work_t* pending = NULL;
+static wait_queue_t worker_queue;
+static process_t* worker = NULL;
+
+static void work_worker();
+
+void init_work() {
+    worker_queue = WAIT_QUEUE_INIT(worker_queue);
+    worker = proc_run_kernel_thread(work_worker);
+}
+
+/* Has the worker run `work`. Interrupt handlers may call this before
+ * `init_work`, the work then runs once it's called.
+ */
+void work_schedule(work_t* work) {
+    uint32_t eflags = irq_save();
+
+    if (!work->pending) {
+        work_t** last = &pending;
+
+        while (*last) {
+            last = &(*last)->next;
+        }
+
+        work->pending = true;
+        work->next = NULL;
+        *last = work;
+
+        if (worker) {
+            wait_queue_wake_one(&worker_queue);
+        }
+    }
+
+    irq_restore(eflags);
+}
+
+/* Adds a copy of `elem` to the ring, returns false if it's full.
+ */
+bool work_ring_push(work_ring_t* ring, const void* elem) {
+    uint32_t head = ring->head;
+
+    if (head - ring->tail == ring->size) {
+        return false;
+    }
+
+    memcpy(&ring->data[(head & (ring->size - 1))*ring->elem_size], elem, ring->elem_size);
+
+    // The element must be written before the consumer can see it
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/* Copies the oldest element of the ring to `elem` without removing it,
+ * returns false if the ring is empty.
+ */
+bool work_ring_peek(work_ring_t* ring, void* elem) {
+    uint32_t tail = ring->tail;
+
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+        return false;
+    }
+
+    memcpy(elem, &ring->data[(tail & (ring->size - 1))*ring->elem_size], ring->elem_size);
+
+    return true;
+}
+
+bool work_ring_pop(work_ring_t* ring, void* elem) {
+    if (!work_ring_peek(ring, elem)) {
+        return false;
+    }
+
+    // The element must be read before the producer can overwrite it
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/* Runs scheduled work, and sleeps when there's none.
+ */
+static void work_worker() {
+    while (true) {
+        CLI();
+        wait_queue_sleep_until(&worker_queue, pending);
+
+        work_t* work = pending;
+        pending = work->next;
+        work->pending = false;
+        STI();
+
+        work->func();
+
+        // The kernel isn't preemptible, see `proc_preempt`
+        cond_resched();
+    }
+}
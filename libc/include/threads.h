@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+#define THRD_STACK_SIZE 0x10000
+
+enum {
+    thrd_success = 0,
+    thrd_error,
+    thrd_busy,
+    thrd_nomem,
+    thrd_timedout
+};
+
+enum {
+    mtx_plain = 0
+};
+
+typedef int (*thrd_start_t)(void*);
+
+typedef struct {
+    uint32_t tid;
+    void* stack;
+} thrd_info_t;
+
+typedef thrd_info_t* thrd_t;
+
+/* A lock that sleeps in the kernel when contended, see `futex.c`.
+ * 0: unlocked, 1: locked, 2: locked and waited for.
+ */
+typedef struct {
+    volatile uint32_t state;
+} mtx_t;
+
+#define MTX_INIT { 0 }
+
+#ifndef _KERNEL_
+int thrd_create(thrd_t* thr, thrd_start_t func, void* arg);
+int thrd_join(thrd_t thr, int* res);
+void thrd_exit(int res) __attribute__((noreturn));
+void thrd_yield();
+
+int mtx_init(mtx_t* mtx, int type);
+int mtx_lock(mtx_t* mtx);
+int mtx_trylock(mtx_t* mtx);
+int mtx_unlock(mtx_t* mtx);
+void mtx_destroy(mtx_t* mtx);
+#endif
@@ -11,5 +11,6 @@
 int chdir(const char* path);
 char* getcwd(char* buf, size_t size);
 int unlink(const char* path);
+int fork();
 
 #endif
\ No newline at end of file
@@ -3,11 +3,39 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#ifdef _KERNEL_
+#include <kernel/slab.h>
+
+static kmem_cache_t* node_cache;
+
+/* The kernel allocates list nodes from their own cache.
+ */
+static list_t* list_node_alloc() {
+    if (!node_cache) {
+        node_cache = kmem_cache_create("list_node", sizeof(list_t));
+    }
+
+    return kmem_cache_alloc(node_cache);
+}
+
+static void list_node_free(list_t* node) {
+    kmem_cache_free(node_cache, node);
+}
+#else
+static list_t* list_node_alloc() {
+    return malloc(sizeof(list_t));
+}
+
+static void list_node_free(list_t* node) {
+    free(node);
+}
+#endif
+
 /* Allocates a node on the heap containing the given data.
  * Note: the node is uninitialized apart from its data.
  */
 list_t* list_node_new(void* data) {
-    list_t* node = (list_t*) malloc(sizeof(list_t));
+    list_t* node = list_node_alloc();
 
     if (!node) {
         return NULL;
@@ -68,7 +96,7 @@ void list_del(list_t* entry) {
     __list_del(entry->prev, entry->next);
     entry->next = NULL; // Safety first, TODO: remove
     entry->prev = NULL;
-    free(entry);
+    list_node_free(entry);
 }
 
 /**
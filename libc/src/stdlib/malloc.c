@@ -6,23 +6,71 @@
 #ifdef _KERNEL_
 #include <kernel/paging.h>
 #include <kernel/pmm.h>
+#include <kernel/smp.h>
+#include <kernel/spinlock.h>
 #include <kernel/sys.h>
+#else
+#include <threads.h>
 #endif
 
-#define MIN_ALIGN 4
+/* This is a segregated-fit allocator with boundary tags.
+ * The heap is a contiguous sequence of blocks ending with a zero-sized, used
+ * "epilogue" block. Each block starts with its size, whose low bits hold flags.
+ * Free blocks also end with their size, which lets a block find its previous
+ * neighbor in constant time when it knows that neighbor is free: adjacent
+ * free blocks are always coalesced.
+ * Free blocks are kept in bins according to the power of two below their
+ * size, and a bitmap of non-empty bins makes finding a large enough block
+ * cheap.
+ */
+
+#define MIN_ALIGN 8
+#define HEADER_SIZE 4
+#define MIN_BLOCK_SIZE 16
+#define NUM_BINS 32
+
+#define BLOCK_USED 1
+#define BLOCK_PREV_USED 2
+#define BLOCK_FLAGS 7
+
+// The heap grows by at least this much at once
+#define HEAP_GROW_MIN 0x4000
+// Free memory at the end of the heap is given back past this size
+#define TRIM_THRESHOLD 0x20000
 
 typedef struct _mem_block_t {
-    struct _mem_block_t* next;
-    uint32_t size; // We use the last bit as a 'used' flag
-    uint8_t data[1];
+    uint32_t size; // Size of the whole block, and flags
+    struct _mem_block_t* next; // Free list links, only valid if free
+    struct _mem_block_t* prev;
 } mem_block_t;
 
 static mem_block_t* bottom = NULL;
-static mem_block_t* top = NULL;
+static mem_block_t* top = NULL; // The epilogue block
+static mem_block_t* bins[NUM_BINS];
+static uint32_t bin_map = 0;
 static uint32_t used_memory = 0;
 
-#ifndef _KERNEL_
+#ifdef _KERNEL_
+// Other CPUs and interrupt handlers may allocate concurrently, even without
+// the big kernel lock, which is why heap pages may have been unmapped since
+// this CPU last flushed its TLB, see `smp.c`
+static spinlock_t heap_lock = SPINLOCK_INIT;
+
+#define mem_lock() uint32_t eflags = spin_lock_irqsave(&heap_lock); smp_sync_tlb()
+#define mem_unlock() spin_unlock_irqrestore(&heap_lock, eflags)
+#else
+// Threads share the heap, see `threads.c`
+static mtx_t heap_lock = MTX_INIT;
+
+#define mem_lock() mtx_lock(&heap_lock)
+#define mem_unlock() mtx_unlock(&heap_lock)
+#endif
+
+static void* mem_aligned_alloc(size_t align, size_t size);
+static void* mem_realloc(void* ptr, size_t size);
+static void mem_free(void* pointer);
 
+#ifndef _KERNEL_
 /* Returns the next multiple of `s` greater than `a`, or `a` if it is a
  * multiple of `s`.
  * Copy of the same function in <kernel/sys.h>
@@ -34,11 +82,56 @@ static uint32_t align_to(uint32_t n, uint32_t align) {
 
     return n + (align - n % align);
 }
+#endif
+
+#ifdef _KERNEL_
+
+static uintptr_t kernel_brk = KERNEL_HEAP_BEGIN;
+
+/* Moves the end of the kernel heap by `size` bytes, mapping or unmapping
+ * pages as needed. Returns the previous end.
+ * Page tables for the whole heap area are created on first use, when we're
+ * still running in the kernel's page directory, so that the heap is shared
+ * across processes.
+ */
+static void* sbrk(intptr_t size) {
+    static bool tables_ready = false;
+    uintptr_t brk = kernel_brk;
+
+    if (!tables_ready) {
+        for (uint32_t i = 0; i < KERNEL_HEAP_SIZE; i += 0x400000) {
+            paging_get_page(KERNEL_HEAP_BEGIN + i, true, PAGE_RW);
+        }
+
+        tables_ready = true;
+    }
+
+    if (brk + size > KERNEL_HEAP_BEGIN + KERNEL_HEAP_SIZE || brk + size < KERNEL_HEAP_BEGIN) {
+        return (void*) -1;
+    }
+
+    uintptr_t mapped_end = align_to(brk, 0x1000);
+    uintptr_t new_end = align_to(brk + size, 0x1000);
+
+    for (uintptr_t page = mapped_end; page < new_end; page += 0x1000) {
+        paging_map_page(page, pmm_alloc_page(), PAGE_RW);
+    }
+
+    for (uintptr_t page = new_end; page < mapped_end; page += 0x1000) {
+        paging_unmap_page(page);
+    }
+
+    kernel_brk += size;
+
+    return (void*) brk;
+}
 
-/* Allocates `n` pages of memory located after the program's memory.
- * Returns a pointer to the first allocated page.
+#else
+
+/* Moves the end of the program's memory by `size` bytes, which may be
+ * negative. Returns the previous end.
  */
-static void* sbrk(uint32_t size) {
+static void* sbrk(intptr_t size) {
     uintptr_t addr;
 
     asm volatile (
@@ -56,113 +149,259 @@ static void* sbrk(uint32_t size) {
 
 #endif
 
-/* Debugging function to print the block list. Only sizes are listed, and a '#'
- * indicates a used block.
+static uint32_t block_size(mem_block_t* block) {
+    return block->size & ~BLOCK_FLAGS;
+}
+
+static mem_block_t* block_next(mem_block_t* block) {
+    return (mem_block_t*) ((uintptr_t) block + block_size(block));
+}
+
+/* Returns the block before `block`, which must be free.
  */
-void mem_print_blocks() {
-    mem_block_t* block = bottom;
+static mem_block_t* block_prev(mem_block_t* block) {
+    uint32_t prev_size = *(uint32_t*) ((uintptr_t) block - 4);
 
-    while (block) {
-        printf("0x%X%s-> ", block->size & ~1, block->size & 1 ? "# " : " ");
+    return (mem_block_t*) ((uintptr_t) block - prev_size);
+}
 
-        if (block->next && block->next < block) {
-            printf("chaining error: block overlaps with previous one\n");
-        }
+static void* block_data(mem_block_t* block) {
+    return (uint8_t*) block + HEADER_SIZE;
+}
 
-        block = block->next;
+/* Returns the block corresponding to `pointer`, given that `pointer` was
+ * previously returned by a call to `malloc`.
+ */
+static mem_block_t* mem_get_block(void* pointer) {
+    return (mem_block_t*) ((uintptr_t) pointer - HEADER_SIZE);
+}
+
+/* Marks a block as free with the given size, writing its footer and updating
+ * its next neighbor.
+ */
+static void mem_set_free(mem_block_t* block, uint32_t size) {
+    block->size = size | (block->size & BLOCK_PREV_USED);
+    *(uint32_t*) ((uintptr_t) block + size - 4) = size;
+    block_next(block)->size &= ~BLOCK_PREV_USED;
+}
+
+static void mem_set_used(mem_block_t* block, uint32_t size) {
+    block->size = size | BLOCK_USED | (block->size & BLOCK_PREV_USED);
+    block_next(block)->size |= BLOCK_PREV_USED;
+}
+
+static uint32_t mem_bin_index(uint32_t size) {
+    return 31 - __builtin_clz(size);
+}
+
+static void mem_bin_insert(mem_block_t* block) {
+    uint32_t i = mem_bin_index(block_size(block));
+
+    block->prev = NULL;
+    block->next = bins[i];
+
+    if (bins[i]) {
+        bins[i]->prev = block;
     }
 
-    printf("none\n");
+    bins[i] = block;
+    bin_map |= 1 << i;
+}
+
+static void mem_bin_remove(mem_block_t* block) {
+    uint32_t i = mem_bin_index(block_size(block));
+
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        bins[i] = block->next;
+    }
+
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+
+    if (!bins[i]) {
+        bin_map &= ~(1 << i);
+    }
 }
 
-/* Returns the size of a block, including the header.
+/* Returns a free block of at least `size` bytes if any, NULL otherwise.
+ * The bin `size` belongs to is searched first-fit, any block in larger bins
+ * is big enough.
  */
-uint32_t mem_block_size(mem_block_t* block) {
-    return sizeof(mem_block_t) + (block->size & ~1);
+static mem_block_t* mem_find_block(uint32_t size) {
+    uint32_t i = mem_bin_index(size);
+
+    for (mem_block_t* block = bins[i]; block; block = block->next) {
+        if (block_size(block) >= size) {
+            return block;
+        }
+    }
+
+    uint32_t larger = i < 31 ? bin_map & ~((2u << i) - 1) : 0;
+
+    if (!larger) {
+        return NULL;
+    }
+
+    return bins[__builtin_ctz(larger)];
 }
 
-/* Returns the block corresponding to `pointer`, given that `pointer` was
- * previously returned by a call to `malloc`.
+/* Sets up an empty heap made of an epilogue block only.
  */
-mem_block_t* mem_get_block(void* pointer) {
-    uintptr_t addr = (uintptr_t) pointer;
+static bool mem_init() {
+    uintptr_t start = (uintptr_t) sbrk(0);
+    uintptr_t first = align_to(start + HEADER_SIZE, MIN_ALIGN) - HEADER_SIZE;
+
+    if (sbrk(first + HEADER_SIZE - start) == (void*) -1) {
+        return false;
+    }
+
+    bottom = (mem_block_t*) first;
+    top = bottom;
+    top->size = BLOCK_USED | BLOCK_PREV_USED;
 
-    return (mem_block_t*) (addr - sizeof(mem_block_t) + 4);
+    return true;
 }
 
-/* Appends a new block of the desired size and alignment to the block list.
- * Note: may insert an intermediary block before the one returned to prevent
- * memory fragmentation. Such a block would be aligned to `MIN_ALIGN`.
+/* Frees a block, coalescing it with its free neighbors. Returns the resulting
+ * free block.
  */
-mem_block_t* mem_new_block(uint32_t size, uint32_t align) {
-    const uint32_t header_size = offsetof(mem_block_t, data);
-
-    // I did the math and we always have next_aligned >= next.
-    uintptr_t next = (uintptr_t) top + mem_block_size(top);
-    uintptr_t next_aligned = align_to(next+header_size, align) - header_size;
-
-    mem_block_t* block = (mem_block_t*) next_aligned;
-    block->size = size | 1;
-    block->next = NULL;
-
-    // Insert a free block between top and our aligned block, if there's enough
-    // space. That block is 8-bytes aligned.
-    next = align_to(next+header_size, MIN_ALIGN) - header_size;
-    if (next_aligned - next > sizeof(mem_block_t) + MIN_ALIGN) {
-        mem_block_t* filler = (mem_block_t*) next;
-        filler->size = next_aligned - next - sizeof(mem_block_t);
-        top->next = filler;
-        top = filler;
+static mem_block_t* mem_release(mem_block_t* block) {
+    uint32_t size = block_size(block);
+    mem_block_t* next = block_next(block);
+
+    if (!(next->size & BLOCK_USED)) {
+        mem_bin_remove(next);
+        size += block_size(next);
     }
 
-    top->next = block;
-    top = block;
+    if (!(block->size & BLOCK_PREV_USED)) {
+        block = block_prev(block);
+        mem_bin_remove(block);
+        size += block_size(block);
+    }
+
+    mem_set_free(block, size);
+    mem_bin_insert(block);
 
     return block;
 }
 
-/* Returns whether the memory pointed to by `block` is a multiple of `align`.
+/* Gives memory back to the system if `block` is a large enough free block at
+ * the end of the heap.
  */
-bool mem_is_aligned(mem_block_t* block, uint32_t align) {
-    uintptr_t addr = (uintptr_t) block->data;
+static void mem_trim(mem_block_t* block) {
+    uint32_t size = block_size(block);
+
+    if (block_next(block) != top || size < TRIM_THRESHOLD) {
+        return;
+    }
+
+    uint32_t release = (size - HEAP_GROW_MIN) & ~0xFFF;
 
-    return addr % align == 0;
+    if (sbrk(-release) == (void*) -1) {
+        return;
+    }
+
+    mem_bin_remove(block);
+    size -= release;
+    top = (mem_block_t*) ((uintptr_t) block + size);
+    top->size = BLOCK_USED;
+    mem_set_free(block, size);
+    mem_bin_insert(block);
 }
 
-/* Searches the block list for a free block of at least `size` and with the
- * proper alignment. Returns the first corresponding block if any, NULL
- * otherwise.
+/* Extends the heap by at least `size` bytes, adding a free block at its end.
+ * Returns whether that succeeded.
  */
-mem_block_t* mem_find_block(uint32_t size, uint32_t align) {
-    if (!bottom) {
-        return NULL;
+static bool mem_grow(uint32_t size) {
+    size = align_to(size > HEAP_GROW_MIN ? size : HEAP_GROW_MIN, 0x1000);
+
+    if (sbrk(size) == (void*) -1) {
+#ifdef _KERNEL_
+        printke("kernel ran out of memory!");
+        abort();
+#else
+        printf("[mem] Allocation failure\n");
+        return false;
+#endif
+    }
+
+    // The previous epilogue becomes the header of the new block
+    mem_block_t* block = top;
+    top = (mem_block_t*) ((uintptr_t) block + size);
+    top->size = BLOCK_USED;
+
+    block->size = size | (block->size & BLOCK_PREV_USED) | BLOCK_USED;
+    mem_release(block);
+
+    return true;
+}
+
+/* Shrinks a used block to `size` bytes if the excess can make a block of its
+ * own, which is then freed.
+ */
+static void mem_split(mem_block_t* block, uint32_t size) {
+    uint32_t excess = block_size(block) - size;
+
+    if (excess < MIN_BLOCK_SIZE) {
+        return;
     }
 
+    mem_block_t* rest = (mem_block_t*) ((uintptr_t) block + size);
+    block->size = size | (block->size & BLOCK_FLAGS);
+    rest->size = excess | BLOCK_USED | BLOCK_PREV_USED;
+    mem_release(rest);
+}
+
+/* Returns the size of the block needed to hold `size` bytes.
+ */
+static uint32_t mem_block_size_for(uint32_t size) {
+    size = align_to(size + HEADER_SIZE, MIN_ALIGN);
+
+    return size < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : size;
+}
+
+/* Debugging function to print the block list. Only sizes are listed, and a '#'
+ * indicates a used block.
+ */
+void mem_print_blocks() {
     mem_block_t* block = bottom;
 
-    while ((block->size & ~1) < size || block->size & 1 || !mem_is_aligned(block, align)) {
-        block = block->next;
+    while (block && block != top) {
+        printf("0x%X%s-> ", block_size(block), block->size & BLOCK_USED ? "# " : " ");
 
-        if (!block) {
-            return NULL;
+        if (block_size(block) < MIN_BLOCK_SIZE) {
+            printf("chaining error: block too small\n");
+            return;
         }
+
+        block = block_next(block);
     }
 
-    return block;
+    printf("none\n");
 }
 
 /* Returns a pointer to a memory area of at least `size` bytes.
  * Note: in the kernel, this function is renamed to `kmalloc`.
  */
 void* malloc(size_t size) {
-    // Accessing basic datatypes at unaligned addresses is apparently undefined
-    // behavior. Four-bytes alignement should be enough for most things.
     return aligned_alloc(MIN_ALIGN, size);
 }
 
 void* calloc(size_t nmemb, size_t size) {
+    if (size && nmemb > (size_t) -1 / size) {
+        return NULL;
+    }
+
     void* ptr = malloc(nmemb * size);
 
+    if (!ptr) {
+        return NULL;
+    }
+
     return memset(ptr, 0, nmemb * size);
 }
 
@@ -171,93 +410,144 @@ void* zalloc(size_t size) {
 }
 
 void* realloc(void* ptr, size_t size) {
+    mem_lock();
+    void* new = mem_realloc(ptr, size);
+    mem_unlock();
+
+    return new;
+}
+
+/* Frees a pointer previously returned by `malloc`.
+ * Note: in the kernel, this function is renamed to `kfree`.
+ */
+void free(void* pointer) {
+    mem_lock();
+    mem_free(pointer);
+    mem_unlock();
+}
+
+/* Returns `size` bytes of memory at an address multiple of `align`.
+ */
+void* aligned_alloc(size_t align, size_t size) {
+    mem_lock();
+    void* ptr = mem_aligned_alloc(align, size);
+    mem_unlock();
+
+    return ptr;
+}
+
+/* Resizes the allocation in place when possible, be it by shrinking it or by
+ * absorbing the following free block, possibly after growing the heap.
+ */
+static void* mem_realloc(void* ptr, size_t size) {
     if (!ptr) {
-        return malloc(size);
+        return mem_aligned_alloc(MIN_ALIGN, size);
     }
 
     if (!size) {
-        free(ptr);
+        mem_free(ptr);
         return NULL;
     }
 
-    void* new = malloc(size);
-    memcpy(new, ptr, mem_get_block(ptr)->size & ~1);
-    free(ptr);
+    mem_block_t* block = mem_get_block(ptr);
+    uint32_t current = block_size(block);
+    uint32_t needed = mem_block_size_for(size);
 
-    return new;
+    if (needed > current) {
+        mem_block_t* next = block_next(block);
+
+        if (next == top && !mem_grow(needed - current)) {
+            return NULL;
+        }
+
+        next = block_next(block);
+
+        if (!(next->size & BLOCK_USED) && current + block_size(next) >= needed) {
+            mem_bin_remove(next);
+            mem_set_used(block, current + block_size(next));
+        } else {
+            void* new = mem_aligned_alloc(MIN_ALIGN, size);
+
+            if (!new) {
+                return NULL;
+            }
+
+            memcpy(new, ptr, current - HEADER_SIZE);
+            mem_free(ptr);
+
+            return new;
+        }
+    }
+
+    mem_split(block, needed);
+    used_memory += block_size(block) - current;
+
+    return ptr;
 }
 
-/* Frees a pointer previously returned by `malloc`.
- * Note: in the kernel, this function is renamed to `kfree`.
- */
-void free(void* pointer) {
+static void mem_free(void* pointer) {
     if (!pointer) {
         return;
     }
 
     mem_block_t* block = mem_get_block(pointer);
-    block->size &= ~1;
-    used_memory -= block->size;
+
+    if (!(block->size & BLOCK_USED)) {
+        printf("[mem] double free of %p\n", pointer);
+        return;
+    }
+
+    used_memory -= block_size(block) - HEADER_SIZE;
+    mem_trim(mem_release(block));
 }
 
-/* Returns `size` bytes of memory at an address multiple of `align`.
- */
-void* aligned_alloc(size_t align, size_t size) {
-    const uint32_t header_size = offsetof(mem_block_t, data);
-    size = align_to(size, 8);
+static void* mem_aligned_alloc(size_t align, size_t size) {
+    if (!top && !mem_init()) {
+        return NULL;
+    }
 
-    // If this is the first allocation, setup the block list:
-    // it starts with an empty, used block, in order to avoid edge cases.
-    if (!top) {
-#ifdef _KERNEL_
-        uintptr_t addr = KERNEL_HEAP_BEGIN;
-        uintptr_t heap_phys = pmm_alloc_pages(KERNEL_HEAP_SIZE/0x1000);
-        paging_map_pages(addr, heap_phys, KERNEL_HEAP_SIZE/0x1000, PAGE_RW);
-#else
-        uintptr_t addr = (uintptr_t) sbrk(header_size);
-#endif
-        bottom = (mem_block_t*) addr;
-        top = bottom;
-        top->size = 1; // That means used, of size 0
-        top->next = NULL;
+    if (align < MIN_ALIGN) {
+        align = MIN_ALIGN;
     }
 
-    mem_block_t* block = mem_find_block(size, align);
+    uint32_t needed = mem_block_size_for(size);
 
-    if (block) {
-        used_memory += block->size;
-        block->size |= 1;
+    // Leave room to cut an aligned block out of the one we'll find
+    uint32_t search = align > MIN_ALIGN ? needed + align + MIN_BLOCK_SIZE : needed;
+    mem_block_t* block = mem_find_block(search);
 
-        return block->data;
-    } else {
-        // We'll have to allocate a new block, so we check if we haven't
-        // exceeded the memory we can distribute.
-        uintptr_t end = (uintptr_t) top + mem_block_size(top) + header_size;
-        end = align_to(end, align) + size;
-#ifdef _KERNEL_
-        // The kernel can't allocate more
-        if (end > KERNEL_HEAP_BEGIN + KERNEL_HEAP_SIZE) {
-            printke("kernel ran out of memory!");
-            abort();
+    if (!block) {
+        if (!mem_grow(search)) {
+            return NULL;
         }
-#else
-        // But userspace can ask the kernel for more
-        uintptr_t brk = (uintptr_t) sbrk(0);
-        if (end > brk) {
-            if (sbrk(end - brk) == (void*) -1) {
-                printf("[mem] Allocation failure\n");
 
-                return NULL;
-            }
-        }
-#endif
+        block = mem_find_block(search);
+    }
 
-        block = mem_new_block(size, align);
+    mem_bin_remove(block);
+    mem_set_used(block, block_size(block));
+
+    // Free the space before the aligned address, if any
+    uintptr_t data = align_to((uintptr_t) block_data(block), align);
+    uint32_t lead = data - HEADER_SIZE - (uintptr_t) block;
+
+    if (lead && lead < MIN_BLOCK_SIZE) {
+        data += align;
+        lead += align;
     }
 
-    used_memory += size;
+    if (lead) {
+        mem_block_t* aligned = (mem_block_t*) (data - HEADER_SIZE);
+        aligned->size = (block_size(block) - lead) | BLOCK_USED;
+        block->size = lead | (block->size & BLOCK_FLAGS);
+        mem_release(block);
+        block = aligned;
+    }
 
-    return block->data;
+    mem_split(block, needed);
+    used_memory += block_size(block) - HEADER_SIZE;
+
+    return block_data(block);
 }
 
 #ifdef _KERNEL_
@@ -273,4 +563,4 @@ void* kamalloc(uint32_t size, uint32_t align) {
 uint32_t memory_usage() {
     return used_memory;
 }
-#endif
\ No newline at end of file
+#endif
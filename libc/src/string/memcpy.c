@@ -1,12 +1,74 @@
 #include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
 
+// Copies at least this large bypass the cache, see `memcpy_nt.S`: they're
+// typically whole frames, which are written once and not read back soon
+#define MEMCPY_NT_THRESHOLD 0x20000
+
+#define CPUID_SSE2 (1 << 26) // `cpuid` leaf 1, %edx
+
+void memcpy_nt(void* dst, const void* src, size_t size);
+
+/* Returns whether the cpu supports SSE2, which non-temporal stores need.
+ * `cpuid` is slow, so it's only asked once.
+ */
+static bool memcpy_has_sse2() {
+    static int8_t sse2 = -1;
+
+    if (sse2 < 0) {
+        uint32_t eax, ebx, ecx, edx;
+        asm volatile("cpuid"
+            : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+            : "a"(1));
+
+        sse2 = (edx & CPUID_SSE2) != 0;
+    }
+
+    return sse2;
+}
+
+/* Copies forward, which `memmove` relies on.
+ * Small copies go byte by byte, `rep movsl` does the rest unless the copy is
+ * large enough for non-temporal stores.
+ */
 void* memcpy(void* dstptr, const void* srcptr, size_t size) {
     unsigned char* dst = (unsigned char*) dstptr;
     const unsigned char* src = (const unsigned char*) srcptr;
 
-    for (size_t i = 0; i < size; i++) {
-        dst[i] = src[i];
+    if (size < 16) {
+        for (size_t i = 0; i < size; i++) {
+            dst[i] = src[i];
+        }
+
+        return dstptr;
+    }
+
+    if (size >= MEMCPY_NT_THRESHOLD && memcpy_has_sse2()) {
+        size_t head = -(uintptr_t) dst & 15;
+
+        for (size_t i = 0; i < head; i++) {
+            *dst++ = *src++;
+        }
+
+        size_t bulk = (size - head) & ~63;
+        memcpy_nt(dst, src, bulk);
+
+        dst += bulk;
+        src += bulk;
+        size -= head + bulk;
     }
 
+    size_t dwords = size / 4;
+    size_t bytes = size % 4;
+
+    asm volatile(
+        "rep movsl\n"
+        "mov %[bytes], %%ecx\n"
+        "rep movsb"
+        : "+D"(dst), "+S"(src), "+c"(dwords)
+        : [bytes] "r"(bytes)
+        : "memory");
+
     return dstptr;
 }
@@ -1,18 +1,36 @@
 #include <string.h>
 
+/* Copies forward with `memcpy` when that can't overwrite what's left to
+ * read, and backward otherwise.
+ */
 void* memmove(void* dstptr, const void* srcptr, size_t size) {
     unsigned char* dst = (unsigned char*) dstptr;
     const unsigned char* src = (const unsigned char*) srcptr;
 
-    if (dst < src) {
-        for (size_t i = 0; i < size; i++) {
-            dst[i] = src[i];
-        }
-    } else {
-        for (size_t i = size; i != 0; i--) {
-            dst[i-1] = src[i-1];
-        }
+    if (dst <= src || dst >= src + size) {
+        return memcpy(dstptr, srcptr, size);
     }
 
+    // Copy the bytes past the last whole dword first, then the dwords from
+    // the last one down
+    dst += size;
+    src += size;
+
+    for (size_t i = 0; i < size % 4; i++) {
+        *--dst = *--src;
+    }
+
+    size_t dwords = size / 4;
+    dst -= 4;
+    src -= 4;
+
+    asm volatile(
+        "std\n"
+        "rep movsl\n"
+        "cld"
+        : "+D"(dst), "+S"(src), "+c"(dwords)
+        :
+        : "memory");
+
     return dstptr;
 }
@@ -1,11 +1,36 @@
 #include <string.h>
+#include <stdint.h>
 
+/* Small buffers are filled byte by byte, larger ones with `rep stosl` once
+ * aligned.
+ */
 void* memset(void* bufptr, int value, size_t size) {
     unsigned char* buf = (unsigned char*) bufptr;
 
-    for (size_t i = 0; i < size; i++) {
-        buf[i] = (unsigned char) value;
+    if (size < 16) {
+        for (size_t i = 0; i < size; i++) {
+            buf[i] = (unsigned char) value;
+        }
+
+        return bufptr;
+    }
+
+    while ((uintptr_t) buf & 3) {
+        *buf++ = (unsigned char) value;
+        size--;
     }
 
+    uint32_t pattern = (unsigned char) value * 0x01010101;
+    size_t dwords = size / 4;
+    size_t bytes = size % 4;
+
+    asm volatile(
+        "rep stosl\n"
+        "mov %[bytes], %%ecx\n"
+        "rep stosb"
+        : "+D"(buf), "+c"(dwords)
+        : "a"(pattern), [bytes] "r"(bytes)
+        : "memory");
+
     return bufptr;
 }
@@ -0,0 +1,136 @@
+#ifndef _KERNEL_
+
+#include <threads.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <kernel/uapi/uapi_syscall.h>
+
+extern int32_t syscall(uint32_t eax);
+extern int32_t syscall1(uint32_t eax, uint32_t ebx);
+extern int32_t syscall2(uint32_t eax, uint32_t ebx, uint32_t ecx);
+extern int32_t syscall3(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx);
+
+/* Where new threads start, with the arguments `thrd_create` left on their
+ * stack. They have nothing to return to.
+ */
+static void thrd_start(thrd_start_t func, void* arg) {
+    thrd_exit(func(arg));
+}
+
+/* Starts a thread running `func(arg)` on a stack of `THRD_STACK_SIZE` bytes.
+ * Threads share the memory and files of their process, which keeps running
+ * until all of its threads have exited, including the one that started it.
+ */
+int thrd_create(thrd_t* thr, thrd_start_t func, void* arg) {
+    thrd_info_t* info = malloc(sizeof(thrd_info_t));
+    uint8_t* stack = aligned_alloc(16, THRD_STACK_SIZE);
+
+    if (!info || !stack) {
+        free(info);
+        free(stack);
+        return thrd_nomem;
+    }
+
+    // Lay out a call to `thrd_start` such that the stack is 16 bytes aligned
+    // at the call, as the compiler expects
+    uint32_t* sp = (uint32_t*) (stack + THRD_STACK_SIZE - 20);
+    sp[0] = 0; // Return address
+    sp[1] = (uintptr_t) func;
+    sp[2] = (uintptr_t) arg;
+
+    info->stack = stack;
+    info->tid = syscall2(SYS_THREAD_CREATE, (uintptr_t) thrd_start, (uintptr_t) sp);
+    *thr = info;
+
+    return thrd_success;
+}
+
+/* Waits for `thr` to exit and frees its stack. Its result is stored in `res`
+ * if it isn't NULL.
+ */
+int thrd_join(thrd_t thr, int* res) {
+    uint32_t value;
+
+    if (syscall2(SYS_THREAD_JOIN, thr->tid, (uintptr_t) &value) < 0) {
+        return thrd_error;
+    }
+
+    if (res) {
+        *res = value;
+    }
+
+    free(thr->stack);
+    free(thr);
+
+    return thrd_success;
+}
+
+void thrd_exit(int res) {
+    syscall1(SYS_THREAD_EXIT, res);
+    __builtin_unreachable();
+}
+
+void thrd_yield() {
+    syscall(SYS_YIELD);
+}
+
+int mtx_init(mtx_t* mtx, int type) {
+    if (type != mtx_plain) {
+        return thrd_error;
+    }
+
+    *mtx = (mtx_t) MTX_INIT;
+
+    return thrd_success;
+}
+
+/* Takes the lock without entering the kernel unless it's contended, in which
+ * case the lock is marked as waited for and we sleep until it's released.
+ */
+int mtx_lock(mtx_t* mtx) {
+    uint32_t state = 0;
+
+    if (__atomic_compare_exchange_n(&mtx->state, &state, 1, false,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return thrd_success;
+    }
+
+    if (state != 2) {
+        state = __atomic_exchange_n(&mtx->state, 2, __ATOMIC_ACQUIRE);
+    }
+
+    while (state) {
+        syscall3(SYS_FUTEX_WAIT, (uintptr_t) &mtx->state, 2, 0);
+        state = __atomic_exchange_n(&mtx->state, 2, __ATOMIC_ACQUIRE);
+    }
+
+    return thrd_success;
+}
+
+int mtx_trylock(mtx_t* mtx) {
+    uint32_t state = 0;
+
+    if (__atomic_compare_exchange_n(&mtx->state, &state, 1, false,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return thrd_success;
+    }
+
+    return thrd_busy;
+}
+
+/* Releases the lock, waking one of the threads waiting for it if any.
+ */
+int mtx_unlock(mtx_t* mtx) {
+    if (__atomic_exchange_n(&mtx->state, 0, __ATOMIC_RELEASE) == 2) {
+        syscall2(SYS_FUTEX_WAKE, (uintptr_t) &mtx->state, 1);
+    }
+
+    return thrd_success;
+}
+
+void mtx_destroy(mtx_t* mtx) {
+    (void) mtx;
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef _KERNEL_
+
+#include <time.h>
+
+#include <kernel/uapi/uapi_syscall.h>
+
+extern int32_t syscall2(uint32_t eax, uint32_t ebx, uint32_t ecx);
+
+/* Reads the clock page when the TSC is usable, which avoids a system call.
+ */
+int clock_gettime(clockid_t clock_id, struct timespec* tp) {
+    const clock_page_t* page = (const clock_page_t*) CLOCK_PAGE_ADDR;
+
+    if (clock_id != CLOCK_MONOTONIC || !page->mult) {
+        return syscall2(SYS_CLOCK_GETTIME, clock_id, (uintptr_t) tp);
+    }
+
+    uint64_t ns = clock_tsc_to_ns(page, clock_read_tsc());
+
+    tp->tv_sec = ns / 1000000000;
+    tp->tv_nsec = ns % 1000000000;
+
+    return 0;
+}
+
+#endif
@@ -29,7 +29,7 @@ int main() {
     snow_render_window(win);
 
     while (true) {
-        wm_event_t evt = snow_get_event(win);
+        wm_event_t evt = snow_wait_event(win, 500);
 
         if (evt.type == WM_EVENT_KBD && evt.kbd.keycode == KBD_T) {
             syscall2(SYS_EXEC, (uintptr_t) "terminal", (uintptr_t) NULL);
@@ -38,7 +38,7 @@ int main() {
         sys_info_t info;
         syscall2(SYS_INFO, SYS_INFO_UPTIME, (uintptr_t) &info);
 
-        uint32_t time = info.uptime;
+        uint32_t time = info.uptime_ms / 1000;
         uint32_t m = time / 60;
         uint32_t s = time % 60;
         itoa(m, time_text+8, 10);
@@ -55,8 +55,6 @@ int main() {
         snow_draw_rect(win->fb, 0, 0, win->fb.width, 22, 0x303030);
         snow_draw_string(win->fb, time_text, x, y, 0xFFFFFF);
         snow_render_window_partial(win, redraw);
-
-        snow_sleep(500);
     }
 
     snow_close_window(win);
@@ -116,6 +116,7 @@ void num_clicked(button_t* btn) {
         break;
     }
     strcpy(text_field->text, dispbuf);
+    ui_invalidate(W(text_field));
 }
 
 int main() {
@@ -211,15 +212,13 @@ int main() {
     strcpy(text_field->text, dispbuf);
 
     while (true) {
-        wm_event_t event = snow_get_event(app.win);
+        wm_event_t event = snow_wait_event(app.win, 0);
 
         ui_handle_input(app, event);
 
         if (event.type) {
             ui_draw(app);
         }
-
-        snow_sleep(30);
     }
 
     return 0;
@@ -67,11 +67,18 @@ void fv_on_draw(folder_view_t* fv, fb_t fb) {
 
     rect_t r = ui_get_absolute_bounds(W(fv));
     snow_draw_rect(fb, r.x, r.y, r.w, r.h, 0x000000);
-    W(fv->vbox)->on_draw(W(fv->vbox), fb);
+
+    // Everything was cleared
+    ui_invalidate(W(fv->vbox));
+    ui_draw_widget(W(fv->vbox), fb);
 }
 
+/* The entries' vbox isn't linked to us as a child, so their changes are
+ * redrawn with the whole view.
+ */
 void fv_on_click(folder_view_t* fv, point_t p) {
     W(fv->vbox)->on_click(W(fv->vbox), p);
+    ui_invalidate(W(fv));
 }
 
 void fv_on_free(folder_view_t* fv) {
@@ -107,7 +114,7 @@ int main() {
     ui_set_root(files, W(fv));
 
     while (running) {
-        wm_event_t e = snow_get_event(files.win);
+        wm_event_t e = snow_wait_event(files.win, 0);
         ui_handle_input(files, e);
         ui_draw(files);
     }
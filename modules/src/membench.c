@@ -0,0 +1,81 @@
+#include <snow.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BYTES_PER_RUN (64 << 20) // Copied per function and size
+
+typedef enum {
+    BENCH_MEMCPY,
+    BENCH_MEMSET,
+    BENCH_MEMMOVE
+} bench_t;
+
+static const uint32_t sizes[] = { 64, 1 << 10, 16 << 10, 256 << 10, 4 << 20 };
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+/* Prints the throughput of one of the mem* functions on buffers of `size`
+ * bytes, in GB/s. `memmove` is measured on overlapping buffers, copying
+ * backward.
+ */
+void bench(bench_t func, uint8_t* dst, uint8_t* src, uint32_t size) {
+    uint32_t iterations = BYTES_PER_RUN / size;
+    uint64_t start = now_ns();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        switch (func) {
+            case BENCH_MEMCPY:
+                memcpy(dst, src, size);
+                break;
+            case BENCH_MEMSET:
+                memset(dst, i, size);
+                break;
+            case BENCH_MEMMOVE:
+                memmove(src + 4, src, size);
+                break;
+        }
+    }
+
+    uint64_t ns = now_ns() - start;
+    ns = ns ? ns : 1;
+
+    // Bytes per nanosecond are GB/s
+    uint32_t centi_gbps = (uint64_t) iterations*size*100 / ns;
+
+    printf("  %d B: %d.%d%d GB/s\n", size, centi_gbps / 100,
+        centi_gbps / 10 % 10, centi_gbps % 10);
+}
+
+int main() {
+    const char* names[] = { "memcpy", "memset", "memmove" };
+    uint32_t max_size = sizes[sizeof(sizes)/sizeof(sizes[0]) - 1];
+    uint8_t* dst = malloc(max_size);
+    uint8_t* src = malloc(max_size + 4);
+
+    if (!dst || !src) {
+        printf("membench: out of memory\n");
+        return 1;
+    }
+
+    memset(src, 0xAB, max_size + 4);
+
+    for (uint32_t f = BENCH_MEMCPY; f <= BENCH_MEMMOVE; f++) {
+        printf("%s:\n", names[f]);
+
+        for (uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+            bench(f, dst, src, sizes[i]);
+        }
+    }
+
+    free(dst);
+    free(src);
+
+    return 0;
+}
@@ -83,7 +83,7 @@ int main(int argc, char* argv[]) {
     }
 
     while (running) {
-        wm_event_t event = snow_get_event(paint.win);
+        wm_event_t event = snow_wait_event(paint.win, 0);
 
         if (!event.type) {
             continue;
@@ -104,6 +104,7 @@ int main(int argc, char* argv[]) {
 
 void on_clear_clicked() {
     canvas->needs_clearing = true;
+    ui_invalidate(W(canvas));
 }
 
 void on_save_clicked() {
@@ -125,6 +126,7 @@ bool load(const char* path, uint32_t w, uint32_t h) {
     } else {
         rect_t r = ui_get_absolute_bounds(W(canvas));
         snow_draw_rgb(paint.win->fb, buf, r.x, r.y, w, h);
+        ui_invalidate(W(canvas));
     }
 
     free(buf);
@@ -0,0 +1,110 @@
+#include <snow.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PIXELS (1024*768) // One frame at a common resolution
+#define ITERATIONS 20
+
+typedef enum {
+    KERNEL_FILL,
+    KERNEL_COPY,
+    KERNEL_RGB,
+    KERNEL_RGB_MASKED,
+    KERNEL_BLEND
+} kernel_t;
+
+static const char* names[] = { "fill", "copy", "rgb", "rgb_masked", "blend" };
+
+static uint32_t* src;
+static uint8_t* rgb;
+
+static void run(kernel_t kernel, bool scalar, uint32_t* dst, uint32_t n) {
+    // A colour the rgb source has often enough to be masked
+    uint32_t mask = 0x102030;
+
+    switch (kernel) {
+        case KERNEL_FILL:
+            (scalar ? snow_fill_span_scalar : snow_fill_span)(dst, 0x9AC4F8, n);
+            break;
+        case KERNEL_COPY:
+            (scalar ? snow_copy_span_scalar : snow_copy_span)(dst, src, n);
+            break;
+        case KERNEL_RGB:
+            (scalar ? snow_rgb_span_scalar : snow_rgb_span)(dst, rgb, n);
+            break;
+        case KERNEL_RGB_MASKED:
+            (scalar ? snow_rgb_masked_span_scalar : snow_rgb_masked_span)(dst, rgb, n, mask);
+            break;
+        case KERNEL_BLEND:
+            (scalar ? snow_blend_span_scalar : snow_blend_span)(dst, src, n);
+            break;
+    }
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+/* Checks that a kernel matches its scalar reference, on a misaligned span
+ * whose length isn't a multiple of the vector width, then prints how fast it
+ * processes a frame.
+ */
+void bench(kernel_t kernel, uint32_t* a, uint32_t* b) {
+    uint32_t n = PIXELS - 3;
+
+    for (uint32_t i = 0; i < PIXELS; i++) {
+        a[i] = b[i] = i*0x01234567;
+    }
+
+    run(kernel, true, a + 1, n);
+    run(kernel, false, b + 1, n);
+
+    bool ok = !memcmp(a, b, PIXELS*sizeof(uint32_t));
+
+    uint64_t start = now_ns();
+
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        run(kernel, false, b, PIXELS);
+    }
+
+    uint32_t us = (now_ns() - start) / 1000 / ITERATIONS;
+    us = us ? us : 1;
+
+    printf("%s: %s, %d us per frame, %d Mpx/s\n", names[kernel],
+        ok ? "ok" : "MISMATCH", us, PIXELS / us);
+}
+
+int main() {
+    uint32_t* a = malloc(PIXELS*sizeof(uint32_t));
+    uint32_t* b = malloc(PIXELS*sizeof(uint32_t));
+    src = malloc(PIXELS*sizeof(uint32_t));
+    rgb = malloc(3*PIXELS);
+
+    if (!a || !b || !src || !rgb) {
+        printf("pixbench: out of memory\n");
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < PIXELS; i++) {
+        src[i] = i*0x9E3779B9;
+        rgb[3*i] = i % 7 ? 0x10 : i;
+        rgb[3*i + 1] = i % 7 ? 0x20 : i >> 8;
+        rgb[3*i + 2] = i % 7 ? 0x30 : i >> 16;
+    }
+
+    for (uint32_t k = KERNEL_FILL; k <= KERNEL_BLEND; k++) {
+        bench(k, a, b);
+    }
+
+    free(a);
+    free(b);
+    free(src);
+    free(rgb);
+
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include <string.h>
 
 #define BUF_SIZE 30
+#define MAX_SHOWN_CACHES 8
 
 void set_str(const char* base, const char* end, uint32_t n, char* s) {
     char num[BUF_SIZE];
@@ -16,33 +17,52 @@ void set_str(const char* base, const char* end, uint32_t n, char* s) {
 }
 
 int main() {
-    window_t* win = snow_open_window("System information", 275, 100, WM_FOREGROUND | WM_SKIP_INPUT);
+    window_t* win = snow_open_window("System information", 275, 116 + 16*MAX_SHOWN_CACHES,
+        WM_FOREGROUND | WM_SKIP_INPUT);
 
     char heap_usage[BUF_SIZE];
     char mem_usage[BUF_SIZE];
     char mem_total[BUF_SIZE];
+    char cache_usage[BUF_SIZE];
+    char wm_frames[BUF_SIZE];
+    char wm_frame_time[BUF_SIZE];
 
     while (true) {
-        wm_event_t evt = snow_get_event(win);
+        wm_event_t evt = snow_wait_event(win, 300);
 
         if (evt.type == WM_EVENT_KBD && evt.kbd.keycode == KBD_ESCAPE) {
             break;
         }
 
         sys_info_t info;
-        syscall2(SYS_INFO, SYS_INFO_MEMORY, (uintptr_t) &info);
+        syscall2(SYS_INFO, SYS_INFO_MEMORY | SYS_INFO_CACHES | SYS_INFO_WM, (uintptr_t) &info);
 
         set_str("Kernel heap used: ", "KiB", info.kernel_heap_usage >> 10, heap_usage);
         set_str("Ram used: ", "KiB", info.ram_usage >> 10, mem_usage);
         set_str("Ram total: ", "MiB", info.ram_total >> 20, mem_total);
+        set_str("Frames composited: ", "", info.wm.frames, wm_frames);
+        set_str("Time per frame: ", "us", info.wm.frames ?
+            info.wm.time_ns / info.wm.frames / 1000 : 0, wm_frame_time);
 
         snow_draw_window(win); // Draws the title bar and borders
         snow_draw_string(win->fb, heap_usage, 4, 24, 0x00AA1100);
         snow_draw_string(win->fb, mem_usage, 4, 40, 0x00AA1100);
         snow_draw_string(win->fb, mem_total, 4, 56, 0x00AA1100);
+        snow_draw_string(win->fb, wm_frames, 4, 72, 0x00AA1100);
+        snow_draw_string(win->fb, wm_frame_time, 4, 88, 0x00AA1100);
+
+        // Per-cache kernel object usage, in KiB of slab pages
+        for (uint32_t i = 0; i < info.num_caches && i < MAX_SHOWN_CACHES; i++) {
+            sys_cache_info_t* c = &info.caches[i];
+            char base[BUF_SIZE];
+
+            strcpy(base, c->name);
+            strcat(base, ": ");
+            set_str(base, "KiB", c->num_pages*4, cache_usage);
+            snow_draw_string(win->fb, cache_usage, 4, 112 + 16*i, 0x00AA1100);
+        }
 
         snow_render_window(win);
-        snow_sleep(300);
     }
 
     snow_close_window(win);
@@ -0,0 +1,51 @@
+#include <snow.h>
+#include <stdio.h>
+#include <time.h>
+
+#define ITERATIONS 100000
+
+/* Measures the round trip of a system call that does nothing, i.e. the cost
+ * of entering and leaving the kernel. Also checks that it succeeds.
+ */
+void bench(const char* name, uint32_t mode) {
+    struct timespec start, end;
+    uint32_t failures = 0;
+
+    syscall_mode = mode;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t tsc_start = clock_read_tsc();
+
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        failures += syscall(SYS_NOP) != 0;
+    }
+
+    uint64_t tsc_end = clock_read_tsc();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    uint64_t ns = (end.tv_sec - start.tv_sec)*1000000000ull + end.tv_nsec - start.tv_nsec;
+
+    printf("%s: %d ns, %d cycles per call\n", name,
+        (uint32_t) (ns / ITERATIONS), (uint32_t) ((tsc_end - tsc_start) / ITERATIONS));
+
+    if (failures) {
+        printf("%s: %d calls failed\n", name, failures);
+    }
+}
+
+int main() {
+    // Let the first system call detect what the cpu supports
+    syscall(SYS_NOP);
+    uint32_t detected = syscall_mode;
+
+    bench("int $0x30", SYSCALL_MODE_INT);
+
+    if (detected == SYSCALL_MODE_SYSENTER) {
+        bench("sysenter", SYSCALL_MODE_SYSENTER);
+    } else {
+        printf("sysenter: unsupported\n");
+    }
+
+    syscall_mode = detected;
+
+    return 0;
+}
@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
+#include <time.h>
 #include <ctype.h>
 #include <ui.h>
 
@@ -19,6 +21,7 @@ void str_append(str_t* str, const char* text);
 void interpret_cmd(str_t* text_buf, str_t* cmd);
 uint32_t count_lines(str_t* str);
 char* scroll_view(char* str);
+int read_output(void* arg);
 
 const uint32_t twidth = 550;
 const uint32_t theight = 342;
@@ -30,31 +33,56 @@ const uint32_t max_line = theight / char_height - 2;
 const char* prompt = "snowflakeos $ ";
 const uint32_t margin = UI_DEFAULT_PADDING;
 const uint32_t text_color = 0xE0E0E0;
-const float cursor_blink_time = 1;
+const uint32_t cursor_blink_ms = 1000;
 
 window_t* win;
 bool cursor = true;
 bool running = true;
 bool focused = true;
 
+// Held while using the buffers or drawing, by both threads, see `read_output`
+mtx_t lock = MTX_INIT;
+str_t* text_buf;
+str_t* input_buf; // What's being typed, drawn after the text
+
 int main() {
     win = snow_open_window("Terminal", twidth, theight, WM_NORMAL);
 
-    syscall(SYS_MAKETTY);
+    // Commands write to our stdout, a thread reads it back
+    FILE tty = {
+        .fd = syscall(SYS_MAKETTY),
+        .name = "tty"
+    };
 
-    str_t* text_buf = str_new(prompt);
-    str_t* input_buf = str_new("");
+    text_buf = str_new(prompt);
+    input_buf = str_new("");
     cursor = true;
 
     uint32_t last_time = 0;
 
     redraw(text_buf, input_buf);
 
+    thrd_t reader;
+
+    if (thrd_create(&reader, read_output, &tty) != thrd_success) {
+        printf("terminal: couldn't start reading output\n");
+        return 1;
+    }
+
     while (running) {
-        wm_event_t event = snow_get_event(win);
+        // Only wake up for the cursor to blink, output is drawn as it comes
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        uint32_t ms = ts.tv_sec*1000 + ts.tv_nsec/1000000;
+        uint32_t timeout = focused ? cursor_blink_ms - ms % cursor_blink_ms : 0;
+
+        wm_event_t event = snow_wait_event(win, timeout);
         wm_kbd_event_t key = event.kbd;
         bool needs_redrawing = false;
 
+        mtx_lock(&lock);
+
         // Do we have focus?
         if (event.type == WM_EVENT_GAINED_FOCUS) {
             focused = true;
@@ -67,10 +95,10 @@ int main() {
 
         // Time & cursor blinks
         if (focused) {
-            sys_info_t info;
-            syscall2(SYS_INFO, SYS_INFO_UPTIME, (uintptr_t) &info);
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
 
-            uint32_t time = (uint32_t) (info.uptime / cursor_blink_time);
+            uint32_t time = (ts.tv_sec*1000 + ts.tv_nsec/1000000) / cursor_blink_ms;
 
             if (time != last_time) {
                 last_time = time;
@@ -79,23 +107,6 @@ int main() {
             }
         }
 
-        // Print things that have been output, if any, and append a prompt
-        const uint32_t buf_size = 256;
-        char buf[buf_size];
-        uint32_t read;
-        bool anything_read = false;
-
-        while ((read = fread(buf, 1, buf_size - 1, stdout))) {
-            buf[read] = '\0';
-            str_append(text_buf, buf);
-            needs_redrawing = true;
-            anything_read = true;
-        }
-
-        if (anything_read) {
-            str_append(text_buf, prompt);
-        }
-
         if (event.type == WM_EVENT_KBD && event.kbd.pressed) {
             needs_redrawing = true;
 
@@ -104,7 +115,8 @@ int main() {
             case KBD_KP_ENTER:
                 str_append(text_buf, input_buf->buf);
                 interpret_cmd(text_buf, input_buf);
-                printf("\n");
+                str_append(text_buf, "\n");
+                str_append(text_buf, prompt);
                 input_buf->buf[0] = '\0';
                 input_buf->len = 0;
                 break;
@@ -127,8 +139,11 @@ int main() {
         if (needs_redrawing) {
             redraw(text_buf, input_buf);
         }
+
+        mtx_unlock(&lock);
     }
 
+    // Exiting also ends the reader thread
     str_free(text_buf);
     str_free(input_buf);
 
@@ -137,6 +152,33 @@ int main() {
     return 0;
 }
 
+/* Appends what commands output to the text as it comes, sleeping in between.
+ * The text always ends with a prompt, which is moved after the output.
+ * Runs in its own thread.
+ */
+int read_output(void* arg) {
+    FILE* tty = arg;
+    const uint32_t buf_size = 256;
+    char buf[buf_size];
+    uint32_t read;
+
+    while ((read = fread(buf, 1, buf_size - 1, tty))) {
+        buf[read] = '\0';
+
+        mtx_lock(&lock);
+
+        text_buf->len -= strlen(prompt);
+        text_buf->buf[text_buf->len] = '\0';
+        str_append(text_buf, buf);
+        str_append(text_buf, prompt);
+        redraw(text_buf, input_buf);
+
+        mtx_unlock(&lock);
+    }
+
+    return 0;
+}
+
 void redraw(str_t* text_buf, const str_t* input_buf) {
     /* Window decorations */
     snow_draw_window(win);
@@ -5,6 +5,21 @@
 #include <string.h>
 #include <stdbool.h>
 
+#define FONT_GLYPHS 256
+#define FONT_HEIGHT 16
+#define GLYPH_MAX_RUNS 4 // In an 8 pixels wide row
+
+/* A glyph as runs of set pixels, row by row. Each run is a byte: the column
+ * it starts at in the low nibble, its length in the high one.
+ */
+typedef struct {
+    uint8_t num_runs[FONT_HEIGHT];
+    uint8_t runs[FONT_HEIGHT][GLYPH_MAX_RUNS];
+} glyph_t;
+
+static glyph_t glyphs[FONT_GLYPHS];
+static uint32_t glyphs_built[FONT_GLYPHS/32];
+
 /* Helper functions */
 
 uint32_t* pixel_offset(fb_t fb, uint32_t x, uint32_t y) {
@@ -68,11 +83,7 @@ void draw_line_horizontal(fb_t fb, int x0, int x1, int y, uint32_t col) {
         x1 = x;
     }
 
-    uint32_t* offset = pixel_offset(fb, x0, y);
-
-    for (int i = 0; i <= x1 - x0; i++) {
-        offset[i] = col;
-    }
+    snow_fill_span(pixel_offset(fb, x0, y), col, x1 - x0 + 1);
 }
 
 void draw_line_vertical(fb_t fb, int x, int y0, int y1, uint32_t col) {
@@ -105,10 +116,7 @@ void snow_draw_rect(fb_t fb, int x, int y, int w, int h, uint32_t col) {
     uint32_t* offset = pixel_offset(fb, x, y);
 
     for (int i = 0; i < h; i++) {
-        for (int j = 0; j < w; j++) {
-            offset[j] = col;
-        }
-
+        snow_fill_span(offset, col, w);
         offset = (uint32_t*) ((uintptr_t) offset + fb.pitch);
     }
 }
@@ -147,26 +155,77 @@ void snow_draw_border(fb_t fb, int x, int y, int w, int h, uint32_t col) {
 
 /* Font stuff */
 
-/* Draws a character from its top left corner at coordinates (x, y).
- * Does not draw the background.
+/* Returns the glyph of character `c`, turning its bitmap into runs the first
+ * time it's asked for.
+ * Bit `j` of a bitmap row is drawn at column `8 - j`.
+ */
+static const glyph_t* get_glyph(uint8_t c) {
+    glyph_t* glyph = &glyphs[c];
+
+    if (glyphs_built[c / 32] & (1 << c % 32)) {
+        return glyph;
+    }
+
+    const uint8_t* bitmap = font_psf + sizeof(font_header_t) + FONT_HEIGHT*c;
+
+    for (int i = 0; i < FONT_HEIGHT; i++) {
+        uint8_t n = 0;
+
+        for (int j = 7; j >= 0; j--) {
+            if (!(bitmap[i] & (1 << j))) {
+                continue;
+            }
+
+            int start = j;
+
+            while (j > 0 && (bitmap[i] & (1 << (j - 1)))) {
+                j--;
+            }
+
+            glyph->runs[i][n++] = (start - j + 1) << 4 | (8 - start);
+        }
+
+        glyph->num_runs[i] = n;
+    }
+
+    glyphs_built[c / 32] |= 1 << c % 32;
+
+    return glyph;
+}
+
+/* Draws a character from its top left corner at coordinates (x, y), clipped
+ * to the buffer. Does not draw the background.
  */
 void snow_draw_character(fb_t fb, char c, int x, int y, uint32_t col) {
-    uint8_t* offset = font_psf + sizeof(font_header_t) + 16*c;
+    const glyph_t* glyph = get_glyph(c);
+    int top = y < 0 ? -y : 0;
+    int bottom = (int) fb.height - y;
+    bottom = bottom < FONT_HEIGHT ? bottom : FONT_HEIGHT;
+
+    for (int i = top; i < bottom; i++) {
+        uint32_t* row = (uint32_t*) (fb.address + (y + i)*fb.pitch);
+
+        for (int r = 0; r < glyph->num_runs[i]; r++) {
+            int x0 = x + (glyph->runs[i][r] & 0xF);
+            int x1 = x0 + (glyph->runs[i][r] >> 4);
 
-    for (int i = 0; i < 16; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (offset[i] & (1 << j)) {
-                snow_draw_pixel(fb, x + 8 - j, y + i, col);
+            x0 = x0 < 0 ? 0 : x0;
+            x1 = x1 < (int) fb.width ? x1 : (int) fb.width;
+
+            for (int j = x0; j < x1; j++) {
+                row[j] = col;
             }
         }
     }
 }
 
 void snow_draw_string(fb_t fb, char* str, int x, int y, uint32_t col) {
-    size_t len = strlen(str);
+    if (y >= (int) fb.height || y + FONT_HEIGHT <= 0) {
+        return;
+    }
 
-    for (size_t i = 0; i < len; i++) {
-        snow_draw_character(fb, str[i], x + 8*i, y, col);
+    for (; *str && x < (int) fb.width; str++, x += 8) {
+        snow_draw_character(fb, *str, x, y, col);
     }
 }
 
@@ -174,28 +233,36 @@ void snow_draw_rgba(fb_t fb, uint32_t* rgba, int x, int y, int w, int h) {
     uint32_t* offset = pixel_offset(fb, x, y);
 
     for (int i = 0; i < h; i++) {
-        memcpy(offset + i * w, rgba + i * w, sizeof(uint32_t) * w);
+        snow_copy_span(offset, rgba + i*w, w);
+        offset = (uint32_t*) ((uintptr_t) offset + fb.pitch);
     }
 }
 
 void snow_draw_rgb(fb_t fb, uint8_t* rgb, int x, int y, int w, int h) {
-    for (int i = 0, c = 0; i < h; i++) {
-        for (int j = 0; j < w; j++, c += 3) {
-            uint32_t col = rgb[c] << 16 | rgb[c+1] << 8 | rgb[c+2];
+    uint32_t* offset = pixel_offset(fb, x, y);
 
-            snow_draw_pixel(fb, x + j, y + i, col);
-        }
+    for (int i = 0; i < h; i++) {
+        snow_rgb_span(offset, rgb + 3*i*w, w);
+        offset = (uint32_t*) ((uintptr_t) offset + fb.pitch);
     }
 }
 
 void snow_draw_rgb_masked(fb_t fb, uint8_t* rgb, int x, int y, int w, int h, uint32_t mask) {
-    for (int i = 0, c = 0; i < h; i++) {
-        for (int j = 0; j < w; j++, c += 3) {
-            uint32_t col = rgb[c] << 16 | rgb[c+1] << 8 | rgb[c+2];
+    uint32_t* offset = pixel_offset(fb, x, y);
 
-            if (col != mask) {
-                snow_draw_pixel(fb, x + j, y + i, col);
-            }
-        }
+    for (int i = 0; i < h; i++) {
+        snow_rgb_masked_span(offset, rgb + 3*i*w, w, mask);
+        offset = (uint32_t*) ((uintptr_t) offset + fb.pitch);
+    }
+}
+
+/* Blends `argb` over the buffer according to its alpha channel.
+ */
+void snow_draw_argb(fb_t fb, uint32_t* argb, int x, int y, int w, int h) {
+    uint32_t* offset = pixel_offset(fb, x, y);
+
+    for (int i = 0; i < h; i++) {
+        snow_blend_span(offset, argb + i*w, w);
+        offset = (uint32_t*) ((uintptr_t) offset + fb.pitch);
     }
 }
\ No newline at end of file
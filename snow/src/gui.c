@@ -13,7 +13,9 @@ uint32_t snow_wm_open_window(fb_t* fb, uint32_t flags) {
     return syscall2(SYS_WM, WM_CMD_OPEN, (uintptr_t) &param);
 }
 
-/* Returns a window object that can be used to draw things in.
+/* Returns a window object that can be used to draw things in. Its buffer is
+ * allocated by the window manager, which reads it when the window is
+ * rendered.
  */
 window_t* snow_open_window(const char* title, int width, int height, uint32_t flags) {
     window_t* win = (window_t*) malloc(sizeof(window_t));
@@ -23,7 +25,7 @@ window_t* snow_open_window(const char* title, int width, int height, uint32_t fl
     win->width = width;
     win->height = height;
     win->fb = (fb_t) {
-        .address = (uintptr_t) zalloc(width*height*bpp/8),
+        .address = 0, // Filled in by the window manager
         .pitch = width*bpp/8,
         .width = width,
         .height = height,
@@ -40,7 +42,6 @@ void snow_close_window(window_t* win) {
     syscall2(SYS_WM, WM_CMD_CLOSE, win->id);
 
     free(win->title);
-    free((void*) win->fb.address);
     free(win);
 }
 
@@ -106,5 +107,23 @@ wm_event_t snow_get_event(window_t* win) {
 
     syscall2(SYS_WM, WM_CMD_EVENT, (uintptr_t) &param);
 
+    return event;
+}
+
+/* Returns the next event of the window, waiting for one for at most `timeout`
+ * milliseconds, or indefinitely if it's zero. The returned event's type is
+ * zero if none came.
+ */
+wm_event_t snow_wait_event(window_t* win, uint32_t timeout) {
+    wm_event_t event;
+
+    wm_param_wait_event_t param = {
+        .win_id = win->id,
+        .event = &event,
+        .timeout = timeout
+    };
+
+    syscall2(SYS_WM, WM_CMD_WAIT_EVENT, (uintptr_t) &param);
+
     return event;
 }
\ No newline at end of file
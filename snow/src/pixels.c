@@ -0,0 +1,254 @@
+#include <snow.h>
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+#include <stdbool.h>
+#include <string.h>
+
+// `cpuid` leaf 1 feature bits
+#define CPUID_SSE2 (1 << 26) // %edx
+#define CPUID_SSSE3 (1 << 9) // %ecx
+
+/* Pixel span kernels: they work on `n` consecutive 32 bpp XRGB pixels, i.e.
+ * one row of a rectangle, so that drawing functions only compute addresses
+ * once per row.
+ * Each kernel has a scalar reference version, which the vectorized ones must
+ * match bit for bit, and which is used when the cpu lacks the instructions
+ * they need. SSE code is only enabled per function with `target`, as libsnow
+ * may be built with `-mno-sse`.
+ */
+
+static bool has_sse2;
+static bool has_ssse3;
+
+/* Asks the cpu what it supports, once.
+ */
+static void pixels_init() {
+    static bool initialized = false;
+
+    if (initialized) {
+        return;
+    }
+
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid"
+        : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+        : "a"(1));
+
+    has_sse2 = (edx & CPUID_SSE2) != 0;
+    has_ssse3 = has_sse2 && (ecx & CPUID_SSSE3);
+    initialized = true;
+}
+
+/* Scalar reference kernels */
+
+void snow_fill_span_scalar(uint32_t* dst, uint32_t col, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] = col;
+    }
+}
+
+void snow_copy_span_scalar(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] = src[i];
+    }
+}
+
+void snow_rgb_span_scalar(uint32_t* dst, const uint8_t* rgb, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++, rgb += 3) {
+        dst[i] = rgb[0] << 16 | rgb[1] << 8 | rgb[2];
+    }
+}
+
+void snow_rgb_masked_span_scalar(uint32_t* dst, const uint8_t* rgb, uint32_t n,
+        uint32_t mask) {
+    for (uint32_t i = 0; i < n; i++, rgb += 3) {
+        uint32_t col = rgb[0] << 16 | rgb[1] << 8 | rgb[2];
+
+        if (col != mask) {
+            dst[i] = col;
+        }
+    }
+}
+
+/* Blends one channel, `x/255` being computed as `(x + 1 + (x >> 8)) >> 8` as
+ * in the vectorized version.
+ */
+static inline uint32_t blend_channel(uint32_t s, uint32_t d, uint32_t a) {
+    uint32_t x = s*a + d*(255 - a);
+
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+void snow_blend_span_scalar(uint32_t* dst, const uint32_t* argb, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t s = argb[i];
+        uint32_t d = dst[i];
+        uint32_t a = s >> 24;
+
+        dst[i] = blend_channel(s >> 16 & 0xFF, d >> 16 & 0xFF, a) << 16 |
+                 blend_channel(s >> 8 & 0xFF, d >> 8 & 0xFF, a) << 8 |
+                 blend_channel(s & 0xFF, d & 0xFF, a);
+    }
+}
+
+/* SSE kernels */
+
+__attribute__((target("sse2")))
+static void fill_span_sse2(uint32_t* dst, uint32_t col, uint32_t n) {
+    __m128i v = _mm_set1_epi32(col);
+
+    // Align `dst` for the stores
+    while (n && ((uintptr_t) dst & 0xF)) {
+        *dst++ = col;
+        n--;
+    }
+
+    for (; n >= 16; n -= 16, dst += 16) {
+        _mm_store_si128((__m128i*) dst, v);
+        _mm_store_si128((__m128i*) dst + 1, v);
+        _mm_store_si128((__m128i*) dst + 2, v);
+        _mm_store_si128((__m128i*) dst + 3, v);
+    }
+
+    for (; n >= 4; n -= 4, dst += 4) {
+        _mm_store_si128((__m128i*) dst, v);
+    }
+
+    snow_fill_span_scalar(dst, col, n);
+}
+
+/* Converts the first four pixels in the 16 bytes at `rgb`.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i rgb_to_xrgb_ssse3(const uint8_t* rgb) {
+    // Byte `i` of the result is byte `shuffle[i]` of the source, or zero
+    const __m128i shuffle = _mm_setr_epi8(
+        2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) rgb), shuffle);
+}
+
+/* The vector loops load 16 bytes for 12 bytes worth of pixels, so they stop
+ * two pixels early so as not to read past the end of `rgb`.
+ */
+__attribute__((target("ssse3")))
+static void rgb_span_ssse3(uint32_t* dst, const uint8_t* rgb, uint32_t n) {
+    uint32_t i = 0;
+
+    for (; i + 6 <= n; i += 4, rgb += 12) {
+        _mm_storeu_si128((__m128i*) (dst + i), rgb_to_xrgb_ssse3(rgb));
+    }
+
+    snow_rgb_span_scalar(dst + i, rgb, n - i);
+}
+
+__attribute__((target("ssse3")))
+static void rgb_masked_span_ssse3(uint32_t* dst, const uint8_t* rgb, uint32_t n,
+        uint32_t mask) {
+    __m128i vmask = _mm_set1_epi32(mask);
+    uint32_t i = 0;
+
+    for (; i + 6 <= n; i += 4, rgb += 12) {
+        __m128i src = rgb_to_xrgb_ssse3(rgb);
+        __m128i old = _mm_loadu_si128((const __m128i*) (dst + i));
+        __m128i keep = _mm_cmpeq_epi32(src, vmask);
+
+        src = _mm_or_si128(_mm_and_si128(keep, old), _mm_andnot_si128(keep, src));
+        _mm_storeu_si128((__m128i*) (dst + i), src);
+    }
+
+    snow_rgb_masked_span_scalar(dst + i, rgb, n - i, mask);
+}
+
+/* Blends two pixels unpacked to 16 bits per channel, with their alpha in
+ * every channel of `a`.
+ */
+__attribute__((target("sse2")))
+static inline __m128i blend_epi16_sse2(__m128i s, __m128i d, __m128i a) {
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(s, a),
+        _mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), a)));
+
+    x = _mm_add_epi16(x, _mm_add_epi16(_mm_set1_epi16(1), _mm_srli_epi16(x, 8)));
+
+    return _mm_srli_epi16(x, 8);
+}
+
+__attribute__((target("sse2")))
+static void blend_span_sse2(uint32_t* dst, const uint32_t* argb, uint32_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    uint32_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*) (argb + i));
+        __m128i d = _mm_loadu_si128((const __m128i*) (dst + i));
+
+        // Alpha in both 16 bits halves of each pixel, then in all four
+        // channels of each unpacked pixel
+        __m128i a = _mm_srli_epi32(s, 24);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+
+        __m128i lo = blend_epi16_sse2(_mm_unpacklo_epi8(s, zero),
+            _mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi32(a, a));
+        __m128i hi = blend_epi16_sse2(_mm_unpackhi_epi8(s, zero),
+            _mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi32(a, a));
+
+        __m128i res = _mm_and_si128(_mm_packus_epi16(lo, hi), rgb_mask);
+        _mm_storeu_si128((__m128i*) (dst + i), res);
+    }
+
+    snow_blend_span_scalar(dst + i, argb + i, n - i);
+}
+
+/* Dispatchers */
+
+void snow_fill_span(uint32_t* dst, uint32_t col, uint32_t n) {
+    pixels_init();
+
+    if (has_sse2) {
+        fill_span_sse2(dst, col, n);
+    } else {
+        snow_fill_span_scalar(dst, col, n);
+    }
+}
+
+/* `memcpy` already uses the best copy loop, see libc's `memcpy.c`.
+ */
+void snow_copy_span(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    memcpy(dst, src, n*sizeof(uint32_t));
+}
+
+/* Without SSSE3, there's no byte shuffle to reorder the channels with.
+ */
+void snow_rgb_span(uint32_t* dst, const uint8_t* rgb, uint32_t n) {
+    pixels_init();
+
+    if (has_ssse3) {
+        rgb_span_ssse3(dst, rgb, n);
+    } else {
+        snow_rgb_span_scalar(dst, rgb, n);
+    }
+}
+
+void snow_rgb_masked_span(uint32_t* dst, const uint8_t* rgb, uint32_t n,
+        uint32_t mask) {
+    pixels_init();
+
+    if (has_ssse3) {
+        rgb_masked_span_ssse3(dst, rgb, n, mask);
+    } else {
+        snow_rgb_masked_span_scalar(dst, rgb, n, mask);
+    }
+}
+
+void snow_blend_span(uint32_t* dst, const uint32_t* argb, uint32_t n) {
+    pixels_init();
+
+    if (has_sse2) {
+        blend_span_sse2(dst, argb, n);
+    } else {
+        snow_blend_span_scalar(dst, argb, n);
+    }
+}
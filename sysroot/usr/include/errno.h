@@ -0,0 +1,5 @@
+#pragma once
+
+#define EISDIR 1
+
+extern int errno;
\ No newline at end of file
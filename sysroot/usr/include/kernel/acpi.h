@@ -0,0 +1,85 @@
+#pragma once
+
+#include <kernel/cpu.h>
+#include <kernel/multiboot2.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ACPI_ISA_IRQS 16
+
+// MADT entry types
+#define MADT_LAPIC 0
+#define MADT_IOAPIC 1
+#define MADT_OVERRIDE 2
+
+#define MADT_LAPIC_ENABLED 1
+
+// Interrupt source override flags
+#define MADT_POLARITY_LOW 0x3
+#define MADT_TRIGGER_LEVEL 0xC
+
+// Header shared by every ACPI table
+typedef struct {
+    char signature[4];
+    uint32_t length; // Including the header
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_header_t;
+
+typedef struct {
+    acpi_header_t header;
+    uint32_t lapic_addr;
+    uint32_t flags;
+    uint8_t entries[];
+} __attribute__((packed)) acpi_madt_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed)) madt_entry_t;
+
+typedef struct {
+    madt_entry_t header;
+    uint8_t processor_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} __attribute__((packed)) madt_lapic_t;
+
+typedef struct {
+    madt_entry_t header;
+    uint8_t ioapic_id;
+    uint8_t reserved;
+    uint32_t address;
+    uint32_t gsi_base;
+} __attribute__((packed)) madt_ioapic_t;
+
+typedef struct {
+    madt_entry_t header;
+    uint8_t bus;
+    uint8_t source; // ISA IRQ
+    uint32_t gsi;
+    uint16_t flags;
+} __attribute__((packed)) madt_override_t;
+
+/* What we need from the MADT to setup interrupt controllers and start
+ * processors. ISA IRQs are identity mapped to global system interrupts unless
+ * overridden, and then active high and edge triggered.
+ */
+typedef struct {
+    uintptr_t lapic_addr;
+    uint32_t num_cpus;
+    uint8_t apic_ids[MAX_CPUS];
+    uintptr_t ioapic_addr; // Only the first IOAPIC is used
+    uint32_t ioapic_gsi_base;
+    uint32_t irq_gsi[ACPI_ISA_IRQS];
+    uint16_t irq_flags[ACPI_ISA_IRQS];
+} acpi_info_t;
+
+void init_acpi(mb2_t* boot);
+const acpi_info_t* acpi_get_info();
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <kernel/isr.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Interrupt vectors of the local APIC, ISA IRQs keeping those of the PICs
+#define APIC_TIMER_VECTOR 64
+#define APIC_RESCHEDULE_VECTOR 65
+#define APIC_TLB_VECTOR 66
+#define APIC_SPURIOUS_VECTOR 255
+
+// Local APIC registers, as offsets from its base address
+#define LAPIC_ID 0x20
+#define LAPIC_TPR 0x80
+#define LAPIC_EOI 0xB0
+#define LAPIC_SVR 0xF0
+#define LAPIC_ICR_LOW 0x300
+#define LAPIC_ICR_HIGH 0x310
+#define LAPIC_LVT_TIMER 0x320
+#define LAPIC_TIMER_INITIAL 0x380
+#define LAPIC_TIMER_CURRENT 0x390
+#define LAPIC_TIMER_DIVIDE 0x3E0
+
+#define LAPIC_ENABLE 0x100 // In the SVR
+#define LAPIC_MASKED (1 << 16)
+#define LAPIC_TIMER_PERIODIC (1 << 17)
+#define LAPIC_DIVIDE_16 0x3
+
+// Interrupt command register, for inter-processor interrupts
+#define ICR_FIXED 0x000
+#define ICR_INIT 0x500
+#define ICR_STARTUP 0x600
+#define ICR_PENDING (1 << 12)
+#define ICR_ASSERT (1 << 14)
+
+// IOAPIC registers, accessed through `IOAPIC_REGSEL` and `IOAPIC_WINDOW`
+#define IOAPIC_REGSEL 0x00
+#define IOAPIC_WINDOW 0x10
+#define IOAPIC_VERSION 0x01
+#define IOAPIC_REDIRECTION 0x10 // Two registers per entry
+
+#define IOAPIC_ACTIVE_LOW (1 << 13)
+#define IOAPIC_LEVEL (1 << 15)
+#define IOAPIC_MASKED (1 << 16)
+
+void init_apic();
+void apic_init_cpu();
+bool apic_enabled();
+uint32_t apic_get_id();
+void apic_send_eoi();
+void apic_send_ipi(uint32_t apic_id, uint32_t command);
+void apic_start_timer();
+void apic_set_timer(bool periodic, uint32_t counts);
+uint32_t apic_get_timer_left();
+uint32_t apic_get_timer_counts();
+void apic_mask_irq(uint32_t irq, bool mask);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <kernel/gdt.h>
+
+#include <stdint.h>
+
+#define MAX_CPUS 16
+
+// `cpuid` leaf 1, %edx
+#define CPUID_TSC (1 << 4)
+#define CPUID_APIC (1 << 9)
+#define CPUID_SEP (1 << 11) // `sysenter` and `sysexit`
+#define CPUID_PAT (1 << 16)
+
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+#define MSR_PAT 0x277
+
+/* Returns the feature flags in %edx of `cpuid` leaf 1.
+ */
+static inline uint32_t cpu_features() {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid"
+        : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+        : "a"(1));
+
+    return edx;
+}
+
+static inline uint64_t cpu_read_msr(uint32_t msr) {
+    uint64_t value;
+    asm volatile("rdmsr" : "=A"(value) : "c"(msr));
+
+    return value;
+}
+
+static inline void cpu_write_msr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" :: "A"(value), "c"(msr));
+}
+
+/* Returns the index of the CPU we're running on, in `cpus`, see `smp.h`.
+ * Each CPU loads its own TSS, whose selector gives it away. Before `init_gdt`,
+ * there's no TSS, but only the bootstrap processor runs.
+ */
+static inline uint32_t cpu_get_id() {
+    uint16_t tr;
+    asm volatile("str %0" : "=r"(tr));
+
+    return tr ? (tr >> 3) - GDT_TSS_ENTRY : 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <kernel/proc.h>
+
+#include <stdint.h>
+
+void init_fpu();
+void fpu_init_cpu();
+void fpu_switch(process_t* prev, const process_t* next);
+void fpu_init_process(process_t* process);
+void fpu_fork(process_t* child);
+void fpu_exit(process_t* process);
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdint.h>
+
+void init_futex();
+int32_t futex_wait(uint32_t* addr, uint32_t expected, uint32_t timeout);
+uint32_t futex_wake(uint32_t* addr, uint32_t count);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <kernel/fs.h>
+
+#include <stdint.h>
+
+uintptr_t page_cache_get(fs_t* fs, uint32_t inode_no, uint32_t index);
+void page_cache_invalidate(fs_t* fs, uint32_t inode_no);
+uint32_t page_cache_reclaim();
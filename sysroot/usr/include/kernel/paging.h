@@ -0,0 +1,95 @@
+#pragma once
+
+#include <kernel/isr.h>
+#include <kernel/multiboot2.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Page directories are arrays of directory entries
+// Page tables are arrays of table entries
+typedef uint32_t directory_entry_t;
+typedef uint32_t page_t;
+
+void init_paging(mb2_t* boot);
+void paging_init_cpu();
+uintptr_t paging_get_kernel_directory();
+page_t* paging_get_page(uintptr_t virt, bool create, uint32_t flags);
+void paging_map_page(uintptr_t virt, uintptr_t phys, uint32_t flags);
+void paging_unmap_page(uintptr_t virt);
+void paging_map_pages(uintptr_t phys, uintptr_t virt, uint32_t num, uint32_t flags);
+void paging_unmap_pages(uintptr_t virt, uint32_t num);
+void paging_switch_directory(uintptr_t dir_phys);
+void paging_invalidate_cache();
+void paging_invalidate_page(uintptr_t virt);
+void paging_fault_handler(registers_t* regs);
+void* paging_alloc_pages(uint32_t virt, uint32_t num);
+void paging_free_pages(uintptr_t virt, uint32_t num);
+uintptr_t paging_virt_to_phys(uintptr_t virt);
+void* paging_map_temp(uintptr_t phys);
+void* paging_map_mmio(uintptr_t phys, uint32_t size);
+void* paging_alloc_shared(uint32_t num);
+void paging_free_shared(void* addr, uint32_t num);
+
+#define KERNEL_BASE_VIRT 0xC0000000
+
+/* The kernel is mapped in higher half using a 4 MiB page.
+ * This is where it ends.
+ */
+#define KERNEL_END_MAP 0xC0400000
+
+/* Our kernel heap starts after our kernel binary, which is small and loaded
+ * at 0xC0100000. It spans 30 MiB, up to the frame array below.
+ * Note: the kernel is mapped by a 4MiB page, so we make our heap begin after
+ * that.
+ */
+#define KERNEL_HEAP_BEGIN KERNEL_END_MAP
+#define KERNEL_HEAP_SIZE 0x1E00000
+
+/* The physical memory manager's per-frame array is mapped on a 4 MiB boundary
+ * after the kernel heap.
+ */
+#define PMM_FRAMES_BEGIN 0xC2400000
+
+/* Pages backing the kernel's object caches are mapped in this area, after the
+ * largest possible frame array.
+ */
+#define KERNEL_SLAB_BEGIN 0xC3000000
+#define KERNEL_SLAB_SIZE 0x1000000
+
+/* A single page used to access arbitrary physical pages, see
+ * `paging_map_temp`.
+ */
+#define KERNEL_TEMP_PAGE 0xC4000000
+
+/* Device registers and firmware tables are mapped in this area, see
+ * `paging_map_mmio`.
+ */
+#define KERNEL_MMIO_BEGIN 0xC4400000
+#define KERNEL_MMIO_SIZE 0x400000
+
+/* Pages shared with userspace, e.g. window surfaces, are mapped in this area,
+ * see `paging_alloc_shared`.
+ */
+#define KERNEL_SHARED_BEGIN 0xC4800000
+#define KERNEL_SHARED_SIZE 0x4000000
+
+/* The framebuffer is mapped at the start of this area, and its back buffer
+ * in the second half, see `fb.c`.
+ */
+#define KERNEL_FB_BEGIN 0xC8800000
+#define KERNEL_FB_SIZE 0x4000000
+
+#define PAGE_PRESENT 1
+#define PAGE_RW      2
+#define PAGE_USER    4
+#define PAGE_WRITETHROUGH 8
+#define PAGE_NOCACHE 16
+#define PAGE_LARGE   128
+#define PAGE_SHARED  512 // Ignored by the CPU: not copied on write by `proc_fork`
+
+// Write-combining if the CPU has a PAT, write-through otherwise, see `paging.c`
+#define PAGE_WRITE_COMBINING PAGE_WRITETHROUGH
+
+#define PAGE_FRAME   0xFFFFF000
+#define PAGE_FLAGS   0x00000FFF
\ No newline at end of file
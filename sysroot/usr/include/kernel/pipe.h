@@ -0,0 +1,6 @@
+#pragma once
+
+#include <kernel/fs.h>
+
+inode_t* pipe_new();
+inode_t* pipe_open_end(inode_t* in, uint32_t flags);
\ No newline at end of file
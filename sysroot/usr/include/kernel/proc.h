@@ -0,0 +1,145 @@
+#pragma once
+
+#include <kernel/fs.h>
+#include <kernel/isr.h>
+#include <kernel/uapi/uapi_clock.h>
+#include <kernel/wait_queue.h>
+
+#include <list.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PROC_STACK_PAGES 256 // Reserved for the stack, backed on demand
+#define PROC_KERNEL_STACK_PAGES 2 // Interrupt handlers nest in system calls
+#define PROC_MAX_FD 1024
+#define PROC_SLEEP_FOREVER 0xFFFFFFFF // For `sleep_ticks`
+
+// Pages shared with the kernel are mapped between the heap and the clock
+// page, see `proc_map_shared`
+#define PROC_SHARED_BEGIN 0xB0000000
+#define PROC_SHARED_END CLOCK_PAGE_ADDR
+
+typedef struct {
+    uint32_t fd;
+    inode_t* inode;
+    uint32_t mode;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t index; // If it's a directory, where we're at
+    uint32_t refcount;
+} ft_entry_t;
+
+/* A range of a process's address space that may be accessed but isn't
+ * necessarily backed by physical memory yet. Pages are allocated and zeroed
+ * the first time they're accessed, see `proc_handle_fault`.
+ * If `fs` is set, the first `file_size` bytes of the region are backed by the
+ * file `inode_no` starting at `file_offset` instead, through the page cache.
+ */
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+    uint32_t flags; // Flags of the pages mapped in the region
+    fs_t* fs;
+    uint32_t inode_no;
+    uint32_t file_offset; // Page-aligned
+    uint32_t file_size;
+} proc_region_t;
+
+// Add new members to the end to avoid messing with the offsets
+typedef struct _proc_t {
+    uint32_t pid;
+    // Sizes of the exectuable and of the stack in number of pages
+    uint32_t stack_len;
+    uint32_t code_len;
+    uintptr_t directory;
+    // Kernel stack used when the process is preempted
+    uintptr_t kernel_stack;
+    // Kernel stack to restore when the process is switched to
+    uintptr_t saved_kernel_stack;
+    // Stack to use when first switching to userspace for a new process
+    uintptr_t initial_user_stack;
+    uint32_t mem_len; // Size of program heap in bytes
+    uint32_t sleep_ticks;
+    uint8_t fpu_registers[512] __attribute__((aligned(16))); // See `fpu.c`
+    list_t filetable;
+    char* cwd;
+    list_t regions;
+    proc_region_t* heap;
+    uintptr_t entry; // Address of the first instruction to run
+    void* sched_data; // Owned by the scheduler
+    uint32_t cpu; // Index of the CPU running the process, see `smp.h`
+    // Threads share the address space, files and working directory of their
+    // leader, the thread the process started with, see `proc_thread_create`
+    struct _proc_t* leader;
+    list_t threads; // Leader only: the other threads, running or not joined
+    uint32_t num_threads; // Leader only: running threads, itself included
+    bool exited; // Off the CPU for good, waiting to be joined unless a leader
+    wait_queue_t join_queue;
+    uint32_t exit_value; // Passed to `thread_exit`, or to `exit` for a leader
+    bool exiting; // Leader only: see `proc_exit_process`
+} process_t;
+
+/* This structure defines the interface of schedulers in SnowflakeOS.
+ */
+typedef struct _sched_t {
+    /* Returns the currently elected process */
+    process_t* (*sched_get_current)(struct _sched_t*);
+    /* Adds a new process, already initialized, to the process pool */
+    void (*sched_add)(struct _sched_t*, process_t*);
+    /* Returns the next process that should be run, depending to the specific
+       scheduler implemented. Note that it can choose not to change process by
+       returning the currently executing process, or return NULL if nothing
+       is runnable, in which case the idle task runs */
+    process_t* (*sched_next)(struct _sched_t*);
+    /* Removes a process from the process pool. Basically the inverse of
+     * `sched_add`. If the removed process was the one currently executing, the
+     * scheduler must ensure that `sched_next` keeps working: it'll be called
+     * right after.
+     */
+    void (*sched_exit)(struct _sched_t*, process_t*);
+    /* Makes a process whose `sleep_ticks` is set runnable again right away */
+    void (*sched_wake)(struct _sched_t*, process_t*);
+    /* Optional: returns the tick at which the first sleeping process wakes up,
+     * zero if there are none. Lets the idle task sleep until then. */
+    uint32_t (*sched_next_wakeup)(struct _sched_t*);
+} sched_t;
+
+void init_proc(const char* cmdline);
+process_t* proc_run_image(inode_t* in, char** argv);
+process_t* proc_fork(registers_t* regs);
+process_t* proc_thread_create(registers_t* regs, uintptr_t entry, uintptr_t stack);
+int32_t proc_thread_join(uint32_t tid, uint32_t* value);
+process_t* proc_run_kernel_thread(void (*entry)());
+void proc_print_processes();
+void proc_schedule();
+void proc_timer_callback(registers_t* regs);
+void proc_preempt(registers_t* regs);
+void cond_resched();
+void proc_exit(uint32_t value);
+void proc_exit_process(uint32_t status);
+void proc_check_exit();
+void proc_enter_usermode();
+void proc_switch_process(process_t* prev, process_t* next);
+uint32_t proc_get_current_pid();
+process_t* proc_get_current();
+char* proc_get_cwd();
+ft_entry_t* proc_new_ft_entry();
+void proc_add_fd(ft_entry_t* entry);
+uint32_t proc_next_fd();
+
+void proc_sleep(uint32_t ms);
+void proc_block(uint32_t ms);
+void proc_wake(process_t* process);
+void* proc_sbrk(intptr_t size);
+uintptr_t proc_map_shared(void* addr, uint32_t num);
+void proc_unmap_shared(uintptr_t addr);
+bool proc_handle_fault(uintptr_t addr, uint32_t err);
+int32_t proc_exec(const char* path, char** argv);
+uint32_t proc_open(const char* path, uint32_t flags);
+void proc_close(uint32_t fd);
+uint32_t proc_read(uint32_t fd, uint8_t* buf, uint32_t size);
+int32_t proc_readdir(uint32_t fd, sos_directory_entry_t* dent);
+uint32_t proc_write(uint32_t fd, uint8_t* buf, uint32_t size);
+int32_t proc_fseek(uint32_t fd, int32_t offset, uint32_t whence);
+int32_t proc_ftell(uint32_t fd);
+int32_t proc_chdir(const char* path);
\ No newline at end of file
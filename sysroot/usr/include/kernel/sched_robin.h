@@ -0,0 +1,5 @@
+#pragma once
+
+#include <kernel/proc.h>
+
+sched_t* sched_robin();
\ No newline at end of file
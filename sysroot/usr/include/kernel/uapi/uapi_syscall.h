@@ -0,0 +1,84 @@
+#pragma once
+
+#include <kernel/uapi/uapi_fs.h>
+
+#include <stdint.h>
+
+#define SYS_YIELD 0
+#define SYS_EXIT 1
+#define SYS_SLEEP 2
+#define SYS_PUTCHAR 3
+#define SYS_SBRK 4
+#define SYS_WM 5
+#define SYS_INFO 6
+#define SYS_EXEC 7
+#define SYS_OPEN 9
+#define SYS_CLOSE 10
+#define SYS_READ 11
+#define SYS_READDIR 12
+#define SYS_WRITE 13
+#define SYS_MKDIR 14
+#define SYS_FSEEK 15
+#define SYS_FTELL 16
+#define SYS_CHDIR 17
+#define SYS_GETCWD 18
+#define SYS_UNLINK 19
+#define SYS_RENAME 20
+#define SYS_MAKETTY 21
+#define SYS_STAT 22
+#define SYS_FORK 23
+#define SYS_CLOCK_GETTIME 24
+#define SYS_THREAD_CREATE 25
+#define SYS_THREAD_EXIT 26
+#define SYS_THREAD_JOIN 27
+#define SYS_FUTEX_WAIT 28
+#define SYS_FUTEX_WAKE 29
+#define SYS_NOP 30
+#define SYS_MAX 31 // First invalid syscall number
+
+// How system calls enter the kernel, see `do_syscall.S` in libc
+#define SYSCALL_MODE_UNKNOWN 0
+#define SYSCALL_MODE_INT 1
+#define SYSCALL_MODE_SYSENTER 2
+
+#define SYS_INFO_UPTIME 1
+#define SYS_INFO_MEMORY 2
+#define SYS_INFO_LOG    4
+#define SYS_INFO_CACHES 8
+#define SYS_INFO_WM     16
+
+#define SYS_INFO_MAX_CACHES 16
+
+/* Usage of one of the kernel's object caches, see `slab.c`.
+ */
+typedef struct {
+    char name[16];
+    uint32_t obj_size;
+    uint32_t active_objs;
+    uint32_t total_objs;
+    uint32_t num_pages;
+} sys_cache_info_t;
+
+/* Work done by the window manager's compositor, see `wm.c`.
+ */
+typedef struct {
+    uint32_t frames;
+    uint64_t pixels; // Drawn to the back buffer
+    uint64_t time_ns; // Spent compositing
+} sys_wm_info_t;
+
+typedef struct {
+    uint32_t kernel_heap_usage;
+    uint32_t ram_usage;
+    uint32_t ram_total;
+    uint32_t uptime_ms;
+    char* kernel_log; // Must be at least 2048 bytes long
+    uint32_t num_caches;
+    sys_cache_info_t caches[SYS_INFO_MAX_CACHES];
+    sys_wm_info_t wm;
+} sys_info_t;
+
+typedef struct {
+    uint8_t* buf;
+    uint32_t size;
+} sys_buf_t;
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <kernel/irq.h>
+#include <kernel/spinlock.h>
+
+#include <list.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* A list of processes waiting for something to happen, e.g. for data to read.
+ */
+typedef struct {
+    list_t waiters;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT(name) (wait_queue_t) { LIST_HEAD_INIT((name).waiters) }
+
+/* Blocks the current process until `condition` holds, checking it again each
+ * time the queue is woken up. Interrupts are disabled in between so that a
+ * handler can't make it hold right before we go to sleep.
+ * Gives up early if the process is being terminated, see `proc_exit_process`.
+ */
+#define wait_queue_sleep_until(queue, condition) \
+    do { \
+        uint32_t __eflags = irq_save(); \
+        while (!(condition) && !wait_queue_interrupted()) { \
+            wait_queue_sleep((queue), 0); \
+        } \
+        irq_restore(__eflags); \
+    } while (0)
+
+bool wait_queue_sleep(wait_queue_t* queue, uint32_t timeout);
+bool wait_queue_sleep_locked(wait_queue_t* queue, spinlock_t* lock, uint32_t timeout);
+void wait_queue_wake_one(wait_queue_t* queue);
+void wait_queue_wake_all(wait_queue_t* queue);
+bool wait_queue_interrupted();
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+double fmax(double a, double b);
+float fmaxf(float a, float b);
+double fmin(double a, double b);
+float fminf(float a, float b);
+int min(int a, int b);
+int max(int a, int b);
+double fabs(double x);
+double ceil(double x);
+double exp(double x);
+double log(double y);
+double pow(double x, double y);
+int powi(int x, int y);
+float clamp(float val, float min, float max);
\ No newline at end of file
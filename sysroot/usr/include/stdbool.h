@@ -0,0 +1,5 @@
+#pragma once
+
+#define bool int
+#define true 1
+#define false 0
\ No newline at end of file
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <string.h>
+
+int strncasecmp(const char* s1, const char* s2, size_t n);
+int strcasecmp(const char* s1, const char* s2);
\ No newline at end of file
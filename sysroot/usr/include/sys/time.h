@@ -0,0 +1 @@
+#pragma once
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <kernel/uapi/uapi_clock.h>
+
+#include <stdint.h>
+
+typedef uint32_t clockid_t;
+
+#ifndef _KERNEL_
+int clock_gettime(clockid_t clock_id, struct timespec* tp);
+#endif
@@ -63,6 +63,13 @@ typedef struct widget_t {
     void (*on_draw)(struct widget_t*, fb_t);
     void (*on_free)(struct widget_t*);
     void (*on_resize)(struct widget_t*);
+    /* Whether the widget needs redrawing, see `ui_invalidate`, and whether
+     * one of its descendants does */
+    bool dirty;
+    bool child_dirty;
+    /* The part of it that changed, if not all of it, in absolute coordinates,
+     * see `ui_invalidate_rect` */
+    rect_t damage;
 } widget_t;
 
 typedef void (*widget_clicked_t)(widget_t*, point_t);
@@ -157,6 +164,9 @@ void ui_app_destroy(ui_app_t app);
 void ui_set_root(ui_app_t app, widget_t* widget);
 void ui_set_title(ui_app_t app, const char* title);
 void ui_draw(ui_app_t app);
+void ui_draw_widget(widget_t* widget, fb_t fb);
+void ui_invalidate(widget_t* widget);
+void ui_invalidate_rect(widget_t* widget, rect_t rect);
 void ui_handle_input(ui_app_t app, wm_event_t event);
 rect_t ui_get_absolute_bounds(widget_t* widget);
 point_t ui_to_child_local(widget_t* widget, point_t point);
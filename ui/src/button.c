@@ -25,6 +25,7 @@ void button_on_draw(button_t* button, fb_t fb) {
 void button_on_click(button_t* button, point_t p) {
     (void) p;
     button->is_clicked = true;
+    ui_invalidate(W(button));
 
     if (button->on_click) {
         button->on_click(button);
@@ -34,6 +35,7 @@ void button_on_click(button_t* button, point_t p) {
 void button_on_release(button_t* button, point_t p) {
     (void) p;
     button->is_clicked = false;
+    ui_invalidate(W(button));
 
     if (button->on_release) {
         button->on_release(button);
@@ -74,4 +76,5 @@ void button_set_text(button_t* button, const char* text) {
     }
 
     button->text = strdup(text);
+    ui_invalidate(W(button));
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <ui.h>
+#include <math.h>
 #include <stdlib.h>
 
 void canvas_on_click(canvas_t* canvas, point_t p) {
@@ -15,6 +16,17 @@ void canvas_on_mouse_move(canvas_t* canvas, point_t p) {
     canvas->needs_drawing = true;
     canvas->last_pos = canvas->new_pos;
     canvas->new_pos = (point_t) { p.x+bounds.x, p.y+bounds.y };
+
+    // Only the new segment of the stroke is drawn, see `canvas_on_draw`
+    if (canvas->is_drawing) {
+        point_t a = canvas->last_pos;
+        point_t b = canvas->new_pos;
+
+        ui_invalidate_rect(W(canvas), (rect_t) {
+            .x = min(a.x, b.x), .y = min(a.y, b.y),
+            .w = abs(a.x - b.x) + 1, .h = abs(a.y - b.y) + 1
+        });
+    }
 }
 
 void canvas_on_mouse_release(canvas_t* canvas, point_t p) {
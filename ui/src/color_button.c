@@ -7,6 +7,7 @@
 void color_button_on_click(color_button_t* button, point_t p) {
     (void) p;
     button->is_clicked = true;
+    ui_invalidate(W(button));
 }
 
 void color_button_on_draw(color_button_t* button, fb_t fb) {
@@ -22,12 +23,16 @@ void color_button_on_draw(color_button_t* button, fb_t fb) {
 void color_button_on_release(color_button_t* button, point_t p) {
     (void) p;
     button->is_clicked = false;
+    ui_invalidate(W(button));
 
     *button->to_set = button->color;
 }
 
 void color_button_on_mouse_exited(color_button_t* button) {
-    button->is_clicked = false;
+    if (button->is_clicked) {
+        button->is_clicked = false;
+        ui_invalidate(W(button));
+    }
 }
 
 void color_button_on_resize(color_button_t* button) {
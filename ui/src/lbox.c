@@ -26,9 +26,11 @@ void lbox_on_draw(lbox_t* lbox, fb_t fb) {
     widget_t* child;
 
     list_for_each_entry(child, &lbox->children) {
-        if (child->on_draw) {
-            child->on_draw(child, fb);
+        if (lbox->widget.dirty) {
+            child->dirty = true;
         }
+
+        ui_draw_widget(child, fb);
     }
 }
 
@@ -212,6 +214,7 @@ void lbox_add(lbox_t* lbox, widget_t* widget) {
 
     list_add(&lbox->children, widget);
     lbox_on_resize(lbox);
+    ui_invalidate(W(lbox));
 }
 
 /* Destroys the children of this container. Their `on_free` method is called
@@ -229,6 +232,8 @@ void lbox_clear(lbox_t* lbox) {
         list_del(elem);
         free(child);
     }
+
+    ui_invalidate(W(lbox));
 }
 
 /* Appends a widget to the right of the last element of the vbox.
@@ -26,4 +26,5 @@ void pixel_buffer_draw(pixel_buffer_t* pb, uint32_t* pixels, uint32_t width, uin
     pb->pixels = pixels;
     pb->width = width;
     pb->height = height;
+    ui_invalidate(W(pb));
 }
\ No newline at end of file
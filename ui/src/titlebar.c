@@ -39,10 +39,12 @@ void titlebar_on_mouse_entered(titlebar_t* tb, point_t p) {
     (void) p;
 
     tb->hovered = true;
+    ui_invalidate(W(tb));
 }
 
 void titlebar_on_mouse_exited(titlebar_t* tb) {
     tb->hovered = false;
+    ui_invalidate(W(tb));
 }
 
 titlebar_t* titlebar_new(const char* title, const uint8_t* icon) {
@@ -70,4 +72,5 @@ void titlebar_set_title(titlebar_t* tb, const char* title) {
     }
 
     tb->title = strdup(title);
+    ui_invalidate(W(tb));
 }
\ No newline at end of file
@@ -6,6 +6,9 @@
 #include <stdio.h>
 #include <math.h>
 
+// What `ui_draw_widget` drew since the last `ui_draw`, in absolute coordinates
+static rect_t damage;
+
 /* Is that point in that rect?
  * Note: see `ui_get_absolute_bounds` and friends if coordinate conversion is
  * needed.
@@ -81,13 +84,96 @@ void ui_app_destroy(ui_app_t app) {
     snow_close_window(app.win);
 }
 
-/* Redraw the app and refresh the window. Usually called in the main loop of
- * a program.
- * TODO: refresh only elements that have changed.
+/* Returns the smallest rect containing both rects, ignoring empty ones.
+ */
+static rect_t ui_rect_union(rect_t a, rect_t b) {
+    if (!a.w || !a.h) {
+        return b;
+    } else if (!b.w || !b.h) {
+        return a;
+    }
+
+    int32_t right = max(a.x + a.w, b.x + b.w);
+    int32_t bottom = max(a.y + a.h, b.y + b.h);
+
+    a.x = min(a.x, b.x);
+    a.y = min(a.y, b.y);
+    a.w = right - a.x;
+    a.h = bottom - a.y;
+
+    return a;
+}
+
+/* Redraws what changed in the app and refreshes that part of the window.
+ * Usually called in the main loop of a program.
  */
 void ui_draw(ui_app_t app) {
-    app.root->on_draw(app.root, app.win->fb);
-    snow_render_window(app.win);
+    damage = (rect_t) {0, 0, 0, 0};
+
+    ui_draw_widget(app.root, app.win->fb);
+
+    if (!damage.w || !damage.h) {
+        return;
+    }
+
+    wm_rect_t clip = {
+        .top = damage.y, .left = damage.x,
+        .bottom = damage.y + damage.h - 1, .right = damage.x + damage.w - 1
+    };
+
+    snow_render_window_partial(app.win, clip);
+}
+
+/* Draws the widget if it was invalidated, or lets it draw its invalidated
+ * descendants. Containers call this on their children from their `on_draw`
+ * callback, after marking them dirty if they are themselves.
+ */
+void ui_draw_widget(widget_t* widget, fb_t fb) {
+    if (!widget->dirty && !widget->child_dirty) {
+        return;
+    }
+
+    if (widget->dirty) {
+        bool partial = widget->damage.w && widget->damage.h;
+        damage = ui_rect_union(damage,
+            partial ? widget->damage : ui_get_absolute_bounds(widget));
+    }
+
+    if (widget->on_draw) {
+        widget->on_draw(widget, fb);
+    }
+
+    widget->dirty = false;
+    widget->child_dirty = false;
+    widget->damage = (rect_t) {0, 0, 0, 0};
+}
+
+/* Marks the widget as needing to be redrawn, to be called whenever something
+ * that changes its appearance happens. The next `ui_draw` redraws it along
+ * with everything inside it, and only updates that part of the window.
+ */
+void ui_invalidate(widget_t* widget) {
+    widget->dirty = true;
+    widget->damage = (rect_t) {0, 0, 0, 0};
+
+    for (widget_t* p = widget->parent; p; p = p->parent) {
+        p->child_dirty = true;
+    }
+}
+
+/* Like `ui_invalidate`, for widgets whose `on_draw` only redraws what
+ * changed: only `rect`, in absolute coordinates, is updated in the window.
+ */
+void ui_invalidate_rect(widget_t* widget, rect_t rect) {
+    // Already invalidated as a whole
+    if (widget->dirty && (!widget->damage.w || !widget->damage.h)) {
+        return;
+    }
+
+    rect_t damage = widget->dirty ? widget->damage : (rect_t) {0, 0, 0, 0};
+
+    ui_invalidate(widget);
+    widget->damage = ui_rect_union(damage, rect);
 }
 
 /* Sets the window title.